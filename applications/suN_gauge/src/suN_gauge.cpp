@@ -12,6 +12,9 @@ using mygroup = SU<NCOLOR, double>;
 
 enum class poly_limit {OFF, RANGE, PARABOLIC};
 
+// single file, one file per rank, or one file per rank written in background
+enum class checkpoint_format {SINGLE, SHARDED, ASYNC};
+
 // define a struct to hold the input parameters: this
 // makes it simpler to pass the values around
 struct parameters {
@@ -24,6 +27,7 @@ struct parameters {
     int n_save;
     int n_profile;
     std::string config_file;
+    checkpoint_format ckpt_format;
     double time_offset;
     poly_limit polyakov_pot;
     double poly_min, poly_max, poly_m2;
@@ -435,22 +439,63 @@ void measure_polyakov_surface(GaugeField<group> &U, const parameters &p, int tra
 
 ////////////////////////////////////////////////////////////////
 
+// run_status of a checkpoint being written in background - it is written
+// only after the config files are complete
+std::string pending_run_status;
+
+void write_run_status(const std::string &status) {
+    if (hila::myrank() == 0) {
+        std::ofstream outf;
+        outf.open("run_status", std::ios::out | std::ios::trunc);
+        outf << status;
+        outf.close();
+    }
+}
+
+// complete the background checkpoint, if any
+void finish_checkpoint() {
+    if (!pending_run_status.empty()) {
+        double t = hila::gettime();
+        hila::wait_checkpoint();
+        write_run_status(pending_run_status);
+        pending_run_status.clear();
+
+        std::stringstream msg;
+        msg << "Checkpoint completed, wait time " << hila::gettime() - t;
+        hila::timestamp(msg.str().c_str());
+    }
+}
+
 template <typename group>
 void checkpoint(const GaugeField<group> &U, int iteration, const parameters &p) {
 
     double t = hila::gettime();
+
+    std::stringstream status;
+    status << "iteration   " << iteration + 1 << '\n';
+    status << "seed        " << static_cast<uint64_t>(hila::random() * (1UL << 61)) << '\n';
+    status << "time        " << hila::gettime() << '\n';
+
+    if (p.ckpt_format == checkpoint_format::ASYNC) {
+        // previous one has to be complete before starting the next
+        finish_checkpoint();
+        U.config_write_async(p.config_file);
+        pending_run_status = status.str();
+
+        std::stringstream msg;
+        msg << "Checkpointing in background, time " << hila::gettime() - t;
+        hila::timestamp(msg.str().c_str());
+        return;
+    }
+
     // save config
-    U.config_write(p.config_file);
+    if (p.ckpt_format == checkpoint_format::SHARDED)
+        U.config_write_sharded(p.config_file);
+    else
+        U.config_write(p.config_file);
 
     // write run_status file
-    if (hila::myrank() == 0) {
-        std::ofstream outf;
-        outf.open("run_status", std::ios::out | std::ios::trunc);
-        outf << "iteration   " << iteration + 1 << '\n';
-        outf << "seed        " << static_cast<uint64_t>(hila::random() * (1UL << 61)) << '\n';
-        outf << "time        " << hila::gettime() << '\n';
-        outf.close();
-    }
+    write_run_status(status.str());
 
     std::stringstream msg;
     msg << "Checkpointing, time " << hila::gettime() - t;
@@ -459,6 +504,17 @@ void checkpoint(const GaugeField<group> &U, int iteration, const parameters &p)
 
 ////////////////////////////////////////////////////////////////
 
+// read config, single file, sharded or ILDG - the format is recognized from the file
+template <typename group>
+void read_config(GaugeField<group> &U, const std::string &filename) {
+    if (hila::is_shard_manifest(filename))
+        U.config_read_sharded(filename);
+    else if (hila::is_lime_file(filename))
+        U.config_read_ildg(filename);
+    else
+        U.config_read(filename);
+}
+
 template <typename group>
 bool restore_checkpoint(GaugeField<group> &U, int &trajectory, parameters &p) {
 
@@ -478,7 +534,7 @@ bool restore_checkpoint(GaugeField<group> &U, int &trajectory, parameters &p) {
 
         hila::seed_random(seed);
 
-        U.config_read(p.config_file);
+        read_config(U, p.config_file);
 
         ok = true;
     } else {
@@ -491,7 +547,7 @@ bool restore_checkpoint(GaugeField<group> &U, int &trajectory, parameters &p) {
 
             hila::out0 << "READING initial config\n";
 
-            U.config_read(p.config_file);
+            read_config(U, p.config_file);
 
             ok = true;
         } else {
@@ -703,6 +759,11 @@ int main(int argc, char **argv) {
     p.n_save = par.get("traj/saved");
     // measure surface properties and print "profile"
     p.config_file = par.get("config name");
+    // single file or one file per rank + manifest, possibly written in background
+    int c_item = par.get_item("checkpoint format", {"single", "sharded", "async"});
+    p.ckpt_format = c_item == 0   ? checkpoint_format::SINGLE
+                    : c_item == 1 ? checkpoint_format::SHARDED
+                                  : checkpoint_format::ASYNC;
 
     // if polyakov range is off, do nothing with
     int p_item = par.get_item("polyakov potential", {"off", "min", "range"});
@@ -821,5 +882,7 @@ int main(int argc, char **argv) {
         }
     }
 
+    finish_checkpoint();
+
     hila::finishrun();
 }
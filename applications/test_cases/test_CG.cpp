@@ -41,6 +41,46 @@ void test_gamma_matrices() {
     }
 }
 
+// Solve DdgD x = a with CG and PipelinedCG, and check that the residuals |a - DdgD x|^2
+// are within the solver accuracy and the solutions agree
+template <typename dirac, typename vtype>
+void compare_pipelined_cg(dirac &D, Field<vtype> &a, Parity par) {
+    const double accuracy = 1e-10;
+    Field<vtype> x_cg, x_pcg, Dx, DdaggerDx;
+    x_cg.copy_boundary_condition(a);
+    x_pcg.copy_boundary_condition(a);
+    Dx.copy_boundary_condition(a);
+    DdaggerDx.copy_boundary_condition(a);
+    x_cg[ALL] = 0;
+    x_pcg[ALL] = 0;
+
+    CG<dirac> cg(D, accuracy);
+    PipelinedCG<dirac> pcg(D, accuracy);
+    cg.apply(a, x_cg);
+    pcg.apply(a, x_pcg);
+
+    double norm = 0, diff = 0, res_cg = 0, res_pcg = 0, source = 0;
+    onsites(par) {
+        norm += squarenorm(x_cg[X]);
+        diff += squarenorm(x_cg[X] - x_pcg[X]);
+        source += squarenorm(a[X]);
+    }
+    D.apply(x_cg, Dx);
+    D.dagger(Dx, DdaggerDx);
+    onsites(par) res_cg += squarenorm(a[X] - DdaggerDx[X]);
+    D.apply(x_pcg, Dx);
+    D.dagger(Dx, DdaggerDx);
+    onsites(par) res_pcg += squarenorm(a[X] - DdaggerDx[X]);
+
+    hila::out0 << "CG residual " << res_cg / source << ", PipelinedCG residual "
+               << res_pcg / source << ", solution difference " << diff / norm << '\n';
+    // recurred residuals drift a little from the true ones, allow a factor 10
+    assert(res_cg / source < 100 * accuracy * accuracy && "test CG residual");
+    assert(res_pcg / source < 100 * accuracy * accuracy && "test PipelinedCG residual");
+    // condition number of DdgD is well below 1e3 for these operators
+    assert(diff / norm < 1e6 * accuracy * accuracy && "test PipelinedCG = CG");
+}
+
 int main(int argc, char **argv) {
 
 #if NDIM == 1
@@ -352,5 +392,28 @@ int main(int argc, char **argv) {
     assert(diffre * diffre < 1e-16 && "test (DdgD)^-1 DdgD");
 }
 
+// Check that the pipelined CG agrees with CG to the solver accuracy
+{
+    hila::out0 << "Checking PipelinedCG against CG\n";
+    {
+        using dirac = dirac_staggered<SU<N>>;
+        dirac D(0.1, U);
+        Field<SU_vector<N, double>> a;
+        onsites(ALL) a[X].gaussian_random();
+        compare_pipelined_cg(D, a, ALL);
+    }
+    {
+        using dirac = Dirac_Wilson_evenodd<SU<N>>;
+        dirac D(0.12, U);
+        Field<Wilson_vector<N, double>> a;
+#if NDIM > 3
+        a.set_boundary_condition(e_t, hila::bc::ANTIPERIODIC);
+#endif
+        a[ODD] = 0;
+        onsites(EVEN) a[X].gaussian_random();
+        compare_pipelined_cg(D, a, EVEN);
+    }
+}
+
 hila::finishrun();
 }
@@ -113,6 +113,10 @@ void TopLevelVisitor::generate_code(Stmt *S) {
 
     SourceRange Srange = get_real_range(S->getSourceRange());
 
+    // fused loops: the text of all loops, the onsites() of the others is removed
+    if (loop_info.fused_bodies.size() > 0)
+        Srange.setEnd(get_real_range(loop_info.fused_bodies.back()->getSourceRange()).getEnd());
+
     loopBuf.copy_from_range(writeBuf, Srange);
 
     //   llvm::errs() << "\nOriginal range: +++++++++++++++\n\""
@@ -131,6 +135,17 @@ void TopLevelVisitor::generate_code(Stmt *S) {
     std::stringstream code;
     code << "{\n";
 
+    // mark fused loops with the lines of the loops, the fusion can be checked from the output
+    if (loop_info.fused_bodies.size() > 0) {
+        SourceLocation sl = Srange.getBegin();
+        code << "// hilapp: site loops fused, " << srcMgr.getFilename(sl).str() << ':'
+             << srcMgr.getSpellingLineNumber(sl);
+        for (Stmt *b : loop_info.fused_bodies)
+            code << ", "
+                 << srcMgr.getSpellingLineNumber(get_real_range(b->getSourceRange()).getBegin());
+        code << '\n';
+    }
+
 
     if (loop_info.contains_random) {
         code << "hila::check_that_rng_is_initialized();\n";
@@ -340,6 +355,22 @@ void TopLevelVisitor::generate_code(Stmt *S) {
     // Place the content of the loop
     code << backend_generate_code(S, semicolon_at_end, loopBuf, generate_wait_loops);
 
+    // Reductions: the sums and the blocking reductions of the special reduction variables
+    // are collected and done in one MPI collective per number type in hila_reduce_sums()
+
+    bool fused_reductions = false;
+    for (reduction_expr &v : reduction_list) {
+        if (v.is_special_reduction || v.reduction_type == reduction::SUM)
+            fused_reductions = true;
+    }
+    for (array_ref &ar : array_ref_list) {
+        if (ar.type == array_ref::REDUCTION)
+            fused_reductions = true;
+    }
+
+    if (fused_reductions)
+        code << "hila::start_fused_reductions();\n";
+
     // Check reduction variables
     for (reduction_expr &v : reduction_list) {
 
@@ -388,19 +419,8 @@ void TopLevelVisitor::generate_code(Stmt *S) {
                 code << "hila_reduce_sum_setup( &" << v.reduction_name << ");\n";
             }
         }
-
-        code << "hila_reduce_sums();\n";
-
-        for (reduction_expr &v : reduction_list) {
-            if (v.reduction_type == reduction::SUM && !v.is_special_reduction) {
-                code << v.name << " = " << v.reduction_name << ";\n";
-            }
-        }
     }
 
-    code << "hila::set_allreduce(true);\n";
-
-
     // and vector reductions
     for (array_ref &ar : array_ref_list) {
         if (ar.type == array_ref::REDUCTION) {
@@ -412,6 +432,19 @@ void TopLevelVisitor::generate_code(Stmt *S) {
         }
     }
 
+    if (fused_reductions)
+        code << "hila_reduce_sums();\n";
+
+    if (sum_reductions) {
+        for (reduction_expr &v : reduction_list) {
+            if (v.reduction_type == reduction::SUM && !v.is_special_reduction) {
+                code << v.name << " = " << v.reduction_name << ";\n";
+            }
+        }
+    }
+
+    code << "hila::set_allreduce(true);\n";
+
     // finally mark modified fields
     for (field_info &l : field_info_list)
         if (l.is_written) {
@@ -445,6 +478,9 @@ void TopLevelVisitor::handle_field_plus_offsets(std::stringstream &code, srcBuf
 
         } else {
 
+            // the shifted fields and offsets, all shifted in one communication round
+            std::vector<std::string> offset_names, offset_exprs;
+
             int i_offset = 0;
             for (dir_ptr &d : it->dir_list)
                 if (d.is_offset) {
@@ -469,10 +505,8 @@ void TopLevelVisitor::handle_field_plus_offsets(std::stringstream &code, srcBuf
                     // push it on stack
                     field_info_list.push_back(new_fi);
 
-                    // copy the shifted var
-                    code << "Field" + it->type_template + " " + offset_field_name + ";\n";
-                    code << it->new_name + ".shift(" + d.ref_list.at(0)->direxpr_s + ", " +
-                                offset_field_name + ", " + paritystr + ");\n";
+                    offset_names.push_back(offset_field_name);
+                    offset_exprs.push_back(d.ref_list.at(0)->direxpr_s);
 
                     // and rewrite references to the offset field
                     for (field_ref *fr : new_fi.ref_list) {
@@ -488,6 +522,22 @@ void TopLevelVisitor::handle_field_plus_offsets(std::stringstream &code, srcBuf
 
                 } // loop over dir_ptr w. offset
 
+            // copy the shifted vars
+            for (auto &name : offset_names)
+                code << "Field" + it->type_template + " " + name + ";\n";
+            if (offset_names.size() == 1) {
+                code << it->new_name + ".shift(" + offset_exprs[0] + ", " + offset_names[0] +
+                            ", " + paritystr + ");\n";
+            } else if (offset_names.size() > 1) {
+                code << it->new_name + ".shift(std::vector<CoordinateVector>{";
+                for (size_t i = 0; i < offset_exprs.size(); i++)
+                    code << (i > 0 ? ", " : "") << offset_exprs[i];
+                code << "}, {";
+                for (size_t i = 0; i < offset_names.size(); i++)
+                    code << (i > 0 ? ", &" : "&") << offset_names[i];
+                code << "}, " << paritystr << ");\n";
+            }
+
             // Remove dir_ptrs which are offset
             // need to do this only if there are no-offset dirs
             std::vector<dir_ptr> dp;
@@ -254,6 +254,8 @@ bool TopLevelVisitor::check_loop_vectorizable(Stmt *S, int &vector_size_, std::s
 
     std::vector<std::string> reason = {};
 
+    bool has_random = loop_info.contains_random;
+
     // check if loop has conditional
     if (loop_info.has_pragma_novector) {
         is_vectorizable = false;
@@ -266,9 +268,18 @@ bool TopLevelVisitor::check_loop_vectorizable(Stmt *S, int &vector_size_, std::s
             reason.push_back("it contains site dependent conditional or array index");
         }
 
-        if (contains_random(S)) {
+        if (has_random && !cmdline::vectorize_random) {
             is_vectorizable = false;
             reason.push_back("it contains a random number generator");
+        } else if (has_random) {
+            // hila::random() etc. have vectorized versions, see backend_vector/defs.h
+            bool scalar_random = contains_scalar_random(S);
+            for (Stmt *body : loop_info.fused_bodies)
+                scalar_random = scalar_random || contains_scalar_random(body);
+            if (scalar_random) {
+                is_vectorizable = false;
+                reason.push_back("it contains a random number generator which is not vectorizable");
+            }
         }
 
         if (selection_info_list.size() > 0) {
@@ -329,6 +340,15 @@ bool TopLevelVisitor::check_loop_vectorizable(Stmt *S, int &vector_size_, std::s
             }
         }
 
+        // vectorized random numbers are double or float
+        if (is_vectorizable && has_random && vinfo.vector_size > 0 &&
+            vinfo.numtype != number_type::DOUBLE && vinfo.numtype != number_type::FLOAT) {
+            is_vectorizable = false;
+            reason.push_back("random numbers are vectorized only in double or float loops, "
+                             "here the type is " +
+                             vinfo.var_type);
+        }
+
         // and still, check the special functions
         if (is_vectorizable) {
             for (auto const &sfc : special_function_call_list) {
@@ -355,10 +375,6 @@ bool TopLevelVisitor::check_loop_vectorizable(Stmt *S, int &vector_size_, std::s
                     is_vectorizable = false;
 
                     reason.push_back("function 'X.parity()' is not AVX vectorizable");
-
-                } else if (sfc.name == "random" || sfc.name == "hila::random") {
-                    is_vectorizable = false;
-                    reason.push_back("random number generators prevent vectorization");
                 }
             }
         }
@@ -470,19 +486,8 @@ std::string TopLevelVisitor::generate_code_avx(Stmt *S, bool semicolon_at_end, s
     code << "const int loop_begin = loop_lattice.loop_begin(" << loop_info.parity_str << ");\n";
     code << "const int loop_end   = loop_lattice.loop_end(" << loop_info.parity_str << ");\n";
 
-    if (generate_wait_loops) {
-        code << "for (int _wait_i_ = 0; _wait_i_ < 2; ++_wait_i_) {\n";
-    }
-
-    // Start the loop
-    code << "for(int " << looping_var << " = loop_begin; " << looping_var << " < loop_end; ++"
-         << looping_var << ") {\n";
-
-    if (generate_wait_loops) {
-        code << "if (((loop_lattice.vec_wait_arr_[" << looping_var
-             << "] & _dir_mask_) != 0) == _wait_i_) {\n";
-    }
-
+    // The loop body, emitted once or several times below
+    std::stringstream body;
 
     // Create temporary field element variables
     for (field_info &l : field_info_list) {
@@ -501,7 +506,7 @@ std::string TopLevelVisitor::generate_code_avx(Stmt *S, bool semicolon_at_end, s
                                 loopBuf.get(d.parityExpr->getSourceRange())); // mapped name was
                                                                               // get_stmt_str(d.e);
 
-                        code << "const " << l.vecinfo.vectorized_type << " " << d.name_with_dir
+                        body << "const " << l.vecinfo.vectorized_type << " " << d.name_with_dir
                              << " = " << l.new_name << ".get_vector_at<"
                              << l.vecinfo.vectorized_type << ">(loop_lattice.neighbours[" << dirname
                              << "][" << looping_var << "]);\n";
@@ -563,18 +568,18 @@ std::string TopLevelVisitor::generate_code_avx(Stmt *S, bool semicolon_at_end, s
         if (l.is_read_atX || (loop_info.has_conditional && l.is_written)) {
             // if (!l.is_written)
             //     code << "const ";
-            code << l.vecinfo.vectorized_type << " " << l.loop_ref_name << " = " << l.new_name
+            body << l.vecinfo.vectorized_type << " " << l.loop_ref_name << " = " << l.new_name
                  << ".get_vector_at<" << l.vecinfo.vectorized_type << ">(" << looping_var << ");\n";
 
             if (loop_info.has_conditional && !l.is_read_atX) {
-                code << "// Value of var " << l.loop_ref_name
+                body << "// Value of var " << l.loop_ref_name
                      << " read in because loop has conditional\n";
-                code << "// TODO: MAY BE UNNECESSARY, write more careful analysis\n";
+                body << "// TODO: MAY BE UNNECESSARY, write more careful analysis\n";
             }
 
         } else if (l.is_written) {
-            code << l.vecinfo.vectorized_type << " " << l.loop_ref_name << ";\n";
-            code << "// Value of var " << l.loop_ref_name << " not needed\n";
+            body << l.vecinfo.vectorized_type << " " << l.loop_ref_name << ";\n";
+            body << "// Value of var " << l.loop_ref_name << " not needed\n";
         }
 
         // and finally replace these references in body
@@ -638,7 +643,10 @@ std::string TopLevelVisitor::generate_code_avx(Stmt *S, bool semicolon_at_end, s
     // Handle calls to special in-loop functions
     for (special_function_call &sfc : special_function_call_list) {
         std::string repl = sfc.replace_expression; // comes with ( now
-        if (sfc.add_loop_var) {
+        if (sfc.name == "random" || sfc.name == "hila::random") {
+            // vector of random numbers, see backend_vector/defs.h
+            repl = "hila::random_vector<" + std::to_string(vector_size) + ">()";
+        } else if (sfc.add_loop_var) {
             repl += looping_var;
             if (sfc.argsExpr != nullptr)
                 repl += ',';
@@ -660,31 +668,27 @@ std::string TopLevelVisitor::generate_code_avx(Stmt *S, bool semicolon_at_end, s
     }
 
     // Dump the main loop code here
-    code << loopBuf.dump();
+    body << loopBuf.dump();
     if (semicolon_at_end)
-        code << ";";
-    code << "\n";
+        body << ";";
+    body << "\n";
 
 
     if (!semicolon_at_end) {
-        code << "}";
+        body << "}";
     }
-    code << "\n";
+    body << "\n";
 
     // Add calls to setters
     for (field_info &l : field_info_list) {
         if (l.is_written) {
-            code << l.new_name << ".set_vector_at<" << l.vecinfo.vectorized_type << ">("
+            body << l.new_name << ".set_vector_at<" << l.vecinfo.vectorized_type << ">("
                  << l.loop_ref_name << ", " << looping_var << ");\n";
         }
     }
 
-    code << "}\n";
-
-    if (generate_wait_loops) {
-        // add the code for 2nd round
-        code << "}\nif (_dir_mask_ == 0) break;    // No need for another round\n";
-
+    // the loops over the sites, as in codegen_cpu.cpp
+    auto wait_gathers = [&]() {
         for (field_info &l : field_info_list) {
             // If neighbour references exist, communicate them
             if (!l.is_loop_local_dir) {
@@ -701,6 +705,48 @@ std::string TopLevelVisitor::generate_code_avx(Stmt *S, bool semicolon_at_end, s
                      << ");\n}\n";
             }
         }
+    };
+
+    if (!generate_wait_loops) {
+        code << "for(int " << looping_var << " = loop_begin; " << looping_var << " < loop_end; ++"
+             << looping_var << ") {\n"
+             << body.str() << "}\n";
+    } else if (!cmdline::wait_site_lists) {
+        // 2 rounds, the vectors which need the halo in the 2nd round
+        code << "for (int _wait_i_ = 0; _wait_i_ < 2; ++_wait_i_) {\n";
+        code << "for(int " << looping_var << " = loop_begin; " << looping_var << " < loop_end; ++"
+             << looping_var << ") {\n";
+        code << "if (((loop_lattice.vec_wait_arr_[" << looping_var
+             << "] & _dir_mask_) != 0) == _wait_i_) {\n";
+        code << body.str() << "}\n}\n";
+        code << "if (_dir_mask_ == 0) break;    // No need for another round\n";
+        wait_gathers();
+        code << "}\n";
+    } else {
+        // interior vectors, wait, and then the boundary vectors
+        code << "if (_dir_mask_ == 0) {\n";
+        code << "for(int " << looping_var << " = loop_begin; " << looping_var << " < loop_end; ++"
+             << looping_var << ") {\n"
+             << body.str() << "}\n";
+        code << "} else {\n";
+        code << "{\n";
+        code << "const auto _wait_site_list_ = loop_lattice.wait_site_list("
+             << loop_info.parity_str << ", false);\n";
+        code << "const unsigned * RESTRICT _wait_sites_ = _wait_site_list_.data();\n";
+        code << "const int _wait_n_ = _wait_site_list_.size();\n";
+        code << "for (int _wait_k_ = 0; _wait_k_ < _wait_n_; ++_wait_k_) {\n";
+        code << "const int " << looping_var << " = _wait_sites_[_wait_k_];\n";
+        code << "hila::progress_comms(_wait_k_);\n";
+        code << body.str() << "}\n}\n";
+        wait_gathers();
+        code << "{\n";
+        code << "const auto _wait_site_list_ = loop_lattice.wait_site_list("
+             << loop_info.parity_str << ", true);\n";
+        code << "const unsigned * RESTRICT _wait_sites_ = _wait_site_list_.data();\n";
+        code << "const int _wait_n_ = _wait_site_list_.size();\n";
+        code << "for (int _wait_k_ = 0; _wait_k_ < _wait_n_; ++_wait_k_) {\n";
+        code << "const int " << looping_var << " = _wait_sites_[_wait_k_];\n";
+        code << body.str() << "}\n}\n";
         code << "}\n";
     }
 
@@ -34,16 +34,14 @@ std::string TopLevelVisitor::generate_code_cpu(Stmt *S, bool semicolon_at_end, s
     code << "const int loop_begin = loop_lattice.loop_begin(" << loop_info.parity_str << ");\n";
     code << "const int loop_end   = loop_lattice.loop_end(" << loop_info.parity_str << ");\n";
 
-    // are there
-
-    if (generate_wait_loops) {
-        code << "for (int _wait_i_ = 0; _wait_i_ < 2; ++_wait_i_) {\n";
-    }
+    // Loop header pragmas are collected separately, because with communication the
+    // loop is emitted in 2 variants (see the end of the function)
+    std::stringstream pragma;
 
     // and the openacc loop header
     if (target.openacc) {
-        generate_openacc_loop_header(code);
-    } else if (target.openmp && !loop_info.contains_random) {
+        generate_openacc_loop_header(pragma);
+    } else if (target.openmp) {
         int sums = 0;
         for (reduction_expr &r : reduction_list) {
             if (r.reduction_type != reduction::NONE &&
@@ -54,34 +52,32 @@ std::string TopLevelVisitor::generate_code_cpu(Stmt *S, bool semicolon_at_end, s
             }
         }
         if (loop_info.has_pragma_omp_parallel_region)
-            code << "#pragma omp for";
+            pragma << "#pragma omp for";
         else
-            code << "#pragma omp parallel for";
+            pragma << "#pragma omp parallel for";
+
+        // random numbers come from per-thread generators: the static schedule keeps
+        // the sites of each thread, and thus the results, reproducible
+        if (loop_info.contains_random)
+            pragma << " schedule(static)";
 
         sums = 0;
         for (reduction_expr &r : reduction_list) {
             if (r.reduction_type != reduction::NONE) {
-                code << " reduction(";
+                pragma << " reduction(";
                 if (get_number_type(r.type) == number_type::UNKNOWN) {
-                    code << "_hila_reduction_sum" << sums;
+                    pragma << "_hila_reduction_sum" << sums;
                 } else {
-                    code << '+';
+                    pragma << '+';
                 }
-                code << ": " << r.reduction_name << ")";
+                pragma << ": " << r.reduction_name << ")";
             }
         }
-        code << '\n';
+        pragma << '\n';
     }
 
-
-    // Start the loop
-    code << "for(int " << looping_var << " = loop_begin; " << looping_var << " < loop_end; ++"
-         << looping_var << ") {\n";
-
-    if (generate_wait_loops) {
-        code << "if (((loop_lattice.wait_arr_[" << looping_var
-             << "] & _dir_mask_) != 0) == _wait_i_) {\n";
-    }
+    // Loop body goes here
+    std::stringstream body;
 
     // replace reduction variables in the loop
     for (reduction_expr &r : reduction_list) {
@@ -123,17 +119,17 @@ std::string TopLevelVisitor::generate_code_cpu(Stmt *S, bool semicolon_at_end, s
                                                                           // get_stmt_str(d.e);
 
                     // generate access stmt
-                    code << "const " << l.element_type << " " << d.name_with_dir << " = "
+                    body << "const " << l.element_type << " " << d.name_with_dir << " = "
                          << l.new_name;
 
                     if (target.vectorize && l.vecinfo.is_vectorizable) {
                         // now l is vectorizable, but accessed sequentially -- this inly
                         // happens in vectorized targets
-                        code << ".get_value_at_nb_site(" << dirname << ", " << looping_var
+                        body << ".get_value_at_nb_site(" << dirname << ", " << looping_var
                              << ");\n";
                     } else {
                         // std neighbour accessor for scalars
-                        code << ".get_value_at(" << l.new_name << ".fs->neighbours[" << dirname
+                        body << ".get_value_at(" << l.new_name << ".fs->neighbours[" << dirname
                              << "][" << looping_var << "]);\n";
                     }
 
@@ -175,20 +171,20 @@ std::string TopLevelVisitor::generate_code_cpu(Stmt *S, bool semicolon_at_end, s
             // now reading var without nb. reference
             // const here may cause problems in loop functions!
             // if (!l.is_written) {
-            //     code << "const ";
+            //     body << "const ";
             // }
-            code << l.element_type << " " << l.loop_ref_name << " = " << l.new_name
+            body << l.element_type << " " << l.loop_ref_name << " = " << l.new_name
                  << ".get_value_at(" << looping_var << ");\n";
 
             if (!l.is_read_atX) {
-                code << "// Value of var " << l.loop_ref_name
+                body << "// Value of var " << l.loop_ref_name
                      << " read in because loop has conditional\n";
-                code << "// TODO: MAY BE UNNECESSARY, write more careful analysis\n";
+                body << "// TODO: MAY BE UNNECESSARY, write more careful analysis\n";
             }
 
         } else if (l.is_written) {
-            code << l.element_type << " " << l.loop_ref_name << ";\n";
-            code << "// Initial value of variable " << l.loop_ref_name << " not needed\n";
+            body << l.element_type << " " << l.loop_ref_name << ";\n";
+            body << "// Initial value of variable " << l.loop_ref_name << " not needed\n";
         }
 
         // and finally replace references in body
@@ -223,24 +219,19 @@ std::string TopLevelVisitor::generate_code_cpu(Stmt *S, bool semicolon_at_end, s
     }
 
     // Dump the main loop code here
-    code << loopBuf.dump();
+    body << loopBuf.dump();
     if (semicolon_at_end)
-        code << ";";
-    code << "\n";
+        body << ";";
+    body << "\n";
 
     // Add calls to setters
     for (field_info &l : field_info_list)
         if (l.is_written) {
-            code << l.new_name << ".set_value_at(" << l.loop_ref_name << ", " << looping_var
+            body << l.new_name << ".set_value_at(" << l.loop_ref_name << ", " << looping_var
                  << ");\n";
         }
 
-    code << "}\n";
-
-    if (generate_wait_loops) {
-        // add the code for 2nd round - also need one } to balance the if ()
-        code << "}\nif (_dir_mask_ == 0) break;    // No need for another round\n";
-
+    auto wait_gathers = [&]() {
         for (field_info &l : field_info_list) {
             // If neighbour references exist, communicate them
             if (!l.is_loop_local_dir) {
@@ -256,6 +247,60 @@ std::string TopLevelVisitor::generate_code_cpu(Stmt *S, bool semicolon_at_end, s
                      << ");\n}\n";
             }
         }
+    };
+
+    if (!generate_wait_loops) {
+        code << pragma.str();
+        code << "for(int " << looping_var << " = loop_begin; " << looping_var << " < loop_end; ++"
+             << looping_var << ") {\n"
+             << body.str() << "}\n";
+    } else if (!cmdline::wait_site_lists) {
+        // 2 rounds over the sites: the sites which need the halo data of the gathers
+        // in _dir_mask_ are done in the 2nd round, after the waits
+        code << "for (int _wait_i_ = 0; _wait_i_ < 2; ++_wait_i_) {\n" << pragma.str();
+        code << "for(int " << looping_var << " = loop_begin; " << looping_var << " < loop_end; ++"
+             << looping_var << ") {\n";
+        code << "if (((loop_lattice.wait_arr_[" << looping_var
+             << "] & _dir_mask_) != 0) == _wait_i_) {\n";
+        code << body.str() << "}\n}\n";
+        code << "if (_dir_mask_ == 0) break;    // No need for another round\n";
+        wait_gathers();
+        code << "}\n";
+    } else {
+        // -wait-site-lists: if all gathers are done, run the plain loop.  Otherwise loop
+        // first over the sites which do not need the halo, wait for the gathers, and then
+        // loop over the rest.  The site lists are precomputed in the lattice, and the two
+        // loops are separate, thus no per-site test
+        code << "if (_dir_mask_ == 0) {\n" << pragma.str();
+        code << "for(int " << looping_var << " = loop_begin; " << looping_var << " < loop_end; ++"
+             << looping_var << ") {\n"
+             << body.str() << "}\n";
+        code << "} else {\n";
+        // interior sites, keeping the messages moving
+        code << "{\n";
+        code << "const auto _wait_site_list_ = loop_lattice.wait_site_list("
+             << loop_info.parity_str << ", false);\n";
+        code << "const unsigned * RESTRICT _wait_sites_ = _wait_site_list_.data();\n";
+        code << "const int _wait_n_ = _wait_site_list_.size();\n";
+        code << pragma.str();
+        code << "for (int _wait_k_ = 0; _wait_k_ < _wait_n_; ++_wait_k_) {\n";
+        code << "const int " << looping_var << " = _wait_sites_[_wait_k_];\n";
+        code << "hila::progress_comms(_wait_k_);\n";
+        code << body.str() << "}\n}\n";
+
+        // wait for the communication
+        wait_gathers();
+
+        // and the boundary sites
+        code << "{\n";
+        code << "const auto _wait_site_list_ = loop_lattice.wait_site_list("
+             << loop_info.parity_str << ", true);\n";
+        code << "const unsigned * RESTRICT _wait_sites_ = _wait_site_list_.data();\n";
+        code << "const int _wait_n_ = _wait_site_list_.size();\n";
+        code << pragma.str();
+        code << "for (int _wait_k_ = 0; _wait_k_ < _wait_n_; ++_wait_k_) {\n";
+        code << "const int " << looping_var << " = _wait_sites_[_wait_k_];\n";
+        code << body.str() << "}\n}\n";
         code << "}\n";
     }
 
@@ -87,3 +87,92 @@ bool GeneralVisitor::contains_random(Stmt *s) {
     fdecls.clear();
     return (checker.found_random);
 }
+
+//////////////////////////////////////////////////////////////////////////////
+/// Check if a statement contains random number calls which cannot be used in
+/// AVX vectorized loops.  These can be:
+///   hila::random()                  in the loop body, replaced by hila::random_vector<N>()
+///   hila::random(v), hila::gaussian_random(v, w)  with arithmetic v, which have
+///                                   overloads for the vector types
+///   random() and gaussian_random() methods of Complex, Matrix and Array
+/// Other rng calls (hila::gaussrand(), SU<N>::random() ...) return scalars.
+//////////////////////////////////////////////////////////////////////////////
+
+static std::vector<FunctionDecl *> scalar_rng_fdecls;
+
+class containsScalarRandomChecker : public GeneralVisitor,
+                                    public RecursiveASTVisitor<containsScalarRandomChecker> {
+
+  public:
+    bool found_scalar_random;
+    bool in_function; // inside a function called from the loop
+
+    template <typename visitor_type>
+    containsScalarRandomChecker(visitor_type &v, bool in_func) : GeneralVisitor(v) {
+        found_scalar_random = false;
+        in_function = in_func;
+    }
+
+    bool VisitStmt(Stmt *S) {
+        if (CallExpr *CE = dyn_cast<CallExpr>(S)) {
+            if (FunctionDecl *FD = CE->getDirectCallee()) {
+                std::string name = FD->getQualifiedNameAsString();
+
+                bool go_inside = false;
+                if (name == "hila::random" || name == "hila::gaussian_random") {
+                    if (CE->getNumArgs() == 0) {
+                        if (!in_function && name == "hila::random")
+                            return true;
+                        found_scalar_random = true;
+                        return false;
+                    }
+                    if (CE->getArg(0)->getType().getCanonicalType()->isArithmeticType())
+                        return true;
+
+                    // template for hila classes, calls method T::random()
+                    go_inside = true;
+                }
+
+                if (CXXMethodDecl *MD = dyn_cast<CXXMethodDecl>(FD)) {
+                    std::string method = MD->getNameAsString();
+                    std::string cls = MD->getParent()->getNameAsString();
+                    if ((method == "random" || method == "gaussian_random") &&
+                        (cls == "Complex" || cls == "Matrix_t" || cls == "Array"))
+                        return true;
+                }
+
+                if (!go_inside && has_pragma(FD, pragma_hila::CONTAINS_RNG)) {
+                    found_scalar_random = true;
+                    return false;
+                }
+
+                if (FD->hasBody()) {
+                    for (auto d : scalar_rng_fdecls) {
+                        if (d == FD)
+                            return true; // was checked
+                    }
+                    scalar_rng_fdecls.push_back(FD);
+
+                    containsScalarRandomChecker chkagain(*this, true);
+                    chkagain.TraverseStmt(FD->getBody());
+                    if (chkagain.found_scalar_random) {
+                        found_scalar_random = true;
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+};
+
+bool GeneralVisitor::contains_scalar_random(Stmt *s) {
+
+    containsScalarRandomChecker checker(*this, false);
+    scalar_rng_fdecls.clear();
+
+    checker.TraverseStmt(s);
+
+    scalar_rng_fdecls.clear();
+    return (checker.found_scalar_random);
+}
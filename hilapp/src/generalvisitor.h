@@ -145,6 +145,9 @@ class GeneralVisitor {
     /// check if stmt contains random number generator
     bool contains_random(Stmt *s);
 
+    /// check if stmt contains rng calls which cannot be AVX vectorized
+    bool contains_scalar_random(Stmt *s);
+
     // shofthand for obtaining file buffer within this class
     srcBuf *get_file_srcBuf(SourceLocation sl) {
         return get_file_buffer(TheRewriter, TheRewriter.getSourceMgr().getFileID(sl));
@@ -101,6 +101,16 @@ llvm::cl::opt<bool> cmdline::no_interleaved_comm(
     "no-interleave", llvm::cl::desc("Do not interleave communications with computation"),
     llvm::cl::cat(HilappCategory));
 
+llvm::cl::opt<bool> cmdline::wait_site_lists(
+    "wait-site-lists",
+    llvm::cl::desc("While communicating, loop over precomputed interior and boundary site "
+                   "lists instead of testing each site (experimental)"),
+    llvm::cl::cat(HilappCategory));
+
+llvm::cl::opt<bool> cmdline::loop_fusion(
+    "loop-fusion", llvm::cl::desc("Fuse adjacent site loops into one loop (experimental)"),
+    llvm::cl::cat(HilappCategory));
+
 llvm::cl::opt<bool> cmdline::check_initialization(
     "check-init",
     llvm::cl::desc("Insert checks that Field variables are appropriately initialized before use"),
@@ -134,6 +144,11 @@ llvm::cl::opt<int> cmdline::vectorize(
                    "For example -target:vectorize=32 is equivalent to -target:AVX"),
     llvm::cl::cat(HilappCategory));
 
+llvm::cl::opt<bool> cmdline::vectorize_random(
+    "vectorize-random",
+    llvm::cl::desc("Vectorize loops with random numbers on AVX targets (experimental)"),
+    llvm::cl::cat(HilappCategory));
+
 llvm::cl::opt<bool> cmdline::openacc("target:openacc",
                                      llvm::cl::desc("Offload to GPU using openACC"),
                                      llvm::cl::cat(HilappCategory));
@@ -260,7 +275,8 @@ struct pragma_types {
 static std::vector<pragma_types> pragma_hila_types{
     {"skip", false},         {"ast_dump", false},        {"loop_function", false},
     {"novector", false},     {"nonvectorizable", false}, {"contains_rng", false},
-    {"direct_access", true}, {"safe_access", true},      {"omp_parallel_region", false}};
+    {"direct_access", true}, {"safe_access", true},      {"omp_parallel_region", false},
+    {"nofuse", false}};
 
 void check_pragmas(std::string &arg, SourceLocation prloc, SourceLocation refloc,
                    std::vector<pragma_loc_struct> &pragmas) {
@@ -78,7 +78,10 @@ extern llvm::cl::opt<bool> openacc;
 extern llvm::cl::opt<bool> c_openmp;
 // extern llvm::cl::opt<bool> func_attribute;
 extern llvm::cl::opt<int> vectorize;
+extern llvm::cl::opt<bool> vectorize_random;
 extern llvm::cl::opt<bool> no_interleaved_comm;
+extern llvm::cl::opt<bool> wait_site_lists;
+extern llvm::cl::opt<bool> loop_fusion;
 // extern llvm::cl::opt<bool> no_mpi;
 extern llvm::cl::opt<int> verbosity;
 extern llvm::cl::opt<int> avx_info;
@@ -406,6 +409,7 @@ struct loop_info_struct {
     Expr *condExpr;
 
     SourceRange range;
+    std::vector<Stmt *> fused_bodies; // bodies of the loops fused after this one
 
     inline void clear_except_external() { // do not remove parity values, may be set in loop init
         has_site_dependent_cond_or_index = contains_random = has_conditional = false;
@@ -507,7 +511,8 @@ enum class pragma_hila {
     CONTAINS_RNG,
     ACCESS,
     SAFE,
-    IN_OMP_PARALLEL_REGION
+    IN_OMP_PARALLEL_REGION,
+    NOFUSE
 };
 
 /// Pragma handling things
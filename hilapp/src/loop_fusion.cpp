@@ -0,0 +1,352 @@
+#include <sstream>
+#include <iostream>
+#include <string>
+
+#include "toplevelvisitor.h"
+#include "hilapp.h"
+#include "stringops.h"
+
+//////////////////////////////////////////////////////////////////////////////
+/// Fusion of adjacent site loops.
+///
+/// Consecutive onsites() -loops in the same compound statement, e.g.
+///
+///     onsites(ALL) {
+///         out[X] += alpha * p[X];
+///         r[X] -= alpha * Dp[X];
+///     }
+///     onsites(ALL) rr += squarenorm(r[X]);
+///
+/// are generated as one loop, saving a pass over the field memory.  The loops are
+/// fused only if the result is the same as with separate loops:
+///  - the parity expressions are the same
+///  - if a loop reads fields from neighbour sites, the other loop does not
+///    write to fields
+///  - a field written in one loop is not accessed in the other through an
+///    expression which could refer to the same field, e.g. U[d] and U[e_x], or
+///    2 reference parameters of a function
+///  - variables assigned in one loop (reductions) are not used in the other loop
+///  - not both loops call random number generators (keeps the numbers the same)
+///  - with vectorization, the field number types are the same and there are no
+///    conditionals, which could prevent vectorization of the fused loop
+///  - the loops have no '#pragma hila' -pragmas.  '#pragma hila nofuse' can be
+///    used to prevent the fusion
+/// Fusion is experimental and done only with option -loop-fusion.
+//////////////////////////////////////////////////////////////////////////////
+
+/// Field expression accessed in a loop
+struct fusion_field_ref {
+    std::string text;         // field expression, e.g. "U[d]"
+    ValueDecl *decl;          // root variable or member, nullptr if unknown
+    bool plain;               // expression is just the variable or member name
+    bool local;               // root is a local non-reference variable
+    bool cannot_alias_local;  // root is a parameter, member or global
+};
+
+/// What the loop does to fields and variables
+struct loop_access_info {
+    std::vector<fusion_field_ref> written, accessed;
+    bool reads_neighbours = false;
+    bool has_random = false;
+    bool has_conditional = false;
+    bool unknown_write = false; // write to something we cannot follow
+    std::set<VarDecl *> assigned_vars, referenced_vars;
+    std::set<number_type> field_types;
+
+    void merge(const loop_access_info &b) {
+        written.insert(written.end(), b.written.begin(), b.written.end());
+        accessed.insert(accessed.end(), b.accessed.begin(), b.accessed.end());
+        reads_neighbours = reads_neighbours || b.reads_neighbours;
+        has_random = has_random || b.has_random;
+        has_conditional = has_conditional || b.has_conditional;
+        unknown_write = unknown_write || b.unknown_write;
+        assigned_vars.insert(b.assigned_vars.begin(), b.assigned_vars.end());
+        referenced_vars.insert(b.referenced_vars.begin(), b.referenced_vars.end());
+        field_types.insert(b.field_types.begin(), b.field_types.end());
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// Collect loop_access_info from the loop body
+//////////////////////////////////////////////////////////////////////////////
+
+class loopAccessScanner : public GeneralVisitor, public RecursiveASTVisitor<loopAccessScanner> {
+
+  public:
+    loop_access_info info;
+    std::set<VarDecl *> local_vars;
+
+    template <typename visitor_type>
+    loopAccessScanner(visitor_type &v) : GeneralVisitor(v) {}
+
+    fusion_field_ref make_field_ref(Expr *fE) {
+        fusion_field_ref r;
+        r.text = remove_all_whitespace(get_stmt_str(fE));
+        r.decl = nullptr;
+        r.plain = r.local = r.cannot_alias_local = false;
+
+        Expr *E = fE->IgnoreParenImpCasts();
+        bool is_name = true;
+        while (E) {
+            if (DeclRefExpr *DRE = dyn_cast<DeclRefExpr>(E)) {
+                r.decl = DRE->getDecl();
+                if (VarDecl *vd = dyn_cast<VarDecl>(r.decl)) {
+                    bool is_ref = vd->getType()->isReferenceType();
+                    r.plain = is_name && !is_ref;
+                    r.local = vd->hasLocalStorage() && !is_ref;
+                    r.cannot_alias_local = isa<ParmVarDecl>(vd) || !vd->hasLocalStorage();
+                }
+                break;
+            } else if (MemberExpr *ME = dyn_cast<MemberExpr>(E)) {
+                Expr *base = ME->getBase()->IgnoreParenImpCasts();
+                if (isa<CXXThisExpr>(base)) {
+                    r.decl = ME->getMemberDecl();
+                    r.plain = is_name && !r.decl->getType()->isReferenceType();
+                    r.cannot_alias_local = true;
+                    break;
+                }
+                E = base;
+            } else if (ArraySubscriptExpr *ASE = dyn_cast<ArraySubscriptExpr>(E)) {
+                E = ASE->getBase()->IgnoreParenImpCasts();
+            } else if (CXXOperatorCallExpr *OC = dyn_cast<CXXOperatorCallExpr>(E)) {
+                if (OC->getOperator() != OO_Subscript)
+                    break;
+                E = OC->getArg(0)->IgnoreParenImpCasts();
+            } else {
+                break;
+            }
+            is_name = false;
+        }
+        return r;
+    }
+
+    // the field expression f in f[X] or f[X+d]
+    Expr *field_of(Expr *E) {
+        CXXOperatorCallExpr *OC = dyn_cast<CXXOperatorCallExpr>(E->IgnoreParens()->IgnoreImplicit());
+        return OC->getArg(0);
+    }
+
+    // E is assigned or passed as a non-const reference
+    void mark_written(Expr *E) {
+        while (E) {
+            E = E->IgnoreParenImpCasts();
+            if (is_field_with_X_expr(E) || is_field_with_X_and_dir(E)) {
+                info.written.push_back(make_field_ref(field_of(E)));
+                return;
+            }
+            if (DeclRefExpr *DRE = dyn_cast<DeclRefExpr>(E)) {
+                if (VarDecl *vd = dyn_cast<VarDecl>(DRE->getDecl())) {
+                    if (local_vars.count(vd) == 0)
+                        info.assigned_vars.insert(vd);
+                    return;
+                }
+                break;
+            } else if (MemberExpr *ME = dyn_cast<MemberExpr>(E)) {
+                E = ME->getBase();
+            } else if (ArraySubscriptExpr *ASE = dyn_cast<ArraySubscriptExpr>(E)) {
+                E = ASE->getBase();
+            } else if (CXXMemberCallExpr *MC = dyn_cast<CXXMemberCallExpr>(E)) {
+                E = MC->getImplicitObjectArgument();
+            } else if (CXXOperatorCallExpr *OC = dyn_cast<CXXOperatorCallExpr>(E)) {
+                if (OC->getOperator() != OO_Subscript)
+                    break;
+                E = OC->getArg(0);
+            } else {
+                break;
+            }
+        }
+        info.unknown_write = true;
+    }
+
+    bool VisitVarDecl(VarDecl *vd) {
+        local_vars.insert(vd);
+        return true;
+    }
+
+    bool VisitDeclRefExpr(DeclRefExpr *DRE) {
+        if (VarDecl *vd = dyn_cast<VarDecl>(DRE->getDecl())) {
+            if (local_vars.count(vd) == 0)
+                info.referenced_vars.insert(vd);
+        }
+        return true;
+    }
+
+    bool VisitStmt(Stmt *s) {
+
+        if (isa<IfStmt>(s) || isa<ConditionalOperator>(s) || isa<SwitchStmt>(s) ||
+            isa<WhileStmt>(s) || isa<DoStmt>(s))
+            info.has_conditional = true;
+
+        Expr *assignee;
+        std::string op;
+        bool is_compound;
+        if (is_assignment_expr(s, &op, is_compound, &assignee) || is_increment_expr(s, &assignee))
+            mark_written(assignee);
+
+        if (CXXMemberCallExpr *MC = dyn_cast<CXXMemberCallExpr>(s)) {
+            CXXMethodDecl *MD = MC->getMethodDecl();
+            if (MD && !MD->isConst() && !MD->isStatic())
+                mark_written(MC->getImplicitObjectArgument());
+        }
+
+        // non-const reference arguments of functions
+        if (CallExpr *CE = dyn_cast<CallExpr>(s)) {
+            FunctionDecl *FD = CE->getDirectCallee();
+            if (FD && !isa<CXXOperatorCallExpr>(CE)) {
+                for (unsigned i = 0; i < CE->getNumArgs() && i < FD->getNumParams(); i++) {
+                    QualType pt = FD->getParamDecl(i)->getType();
+                    if (pt->isReferenceType() && !pt.getNonReferenceType().isConstQualified())
+                        mark_written(CE->getArg(i));
+                }
+            }
+        }
+
+        if (Expr *E = dyn_cast<Expr>(s)) {
+            if (is_field_with_X_and_dir(E)) {
+                info.reads_neighbours = true;
+                info.accessed.push_back(make_field_ref(field_of(E)));
+            } else if (is_field_with_X_expr(E)) {
+                info.accessed.push_back(make_field_ref(field_of(E)));
+                vectorization_info vi;
+                if (is_vectorizable_type(E->getType(), vi))
+                    info.field_types.insert(vi.basetype);
+                else
+                    info.field_types.insert(number_type::UNKNOWN);
+            }
+        }
+        return true;
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+/// Can field expressions a and b refer to the same field?
+//////////////////////////////////////////////////////////////////////////////
+
+static bool may_alias(const fusion_field_ref &a, const fusion_field_ref &b) {
+
+    // the same expression is the same field in the fused loop too
+    if (a.text == b.text)
+        return false;
+
+    if (a.decl == nullptr || b.decl == nullptr)
+        return true;
+
+    if (a.plain && b.plain)
+        return a.decl == b.decl;
+
+    // local objects are not reachable through parameters, members or globals
+    if (a.local && a.plain && b.cannot_alias_local)
+        return false;
+    if (b.local && b.plain && a.cannot_alias_local)
+        return false;
+
+    return true;
+}
+
+static bool writes_may_alias(const loop_access_info &a, const loop_access_info &b) {
+    for (auto &w : a.written)
+        for (auto &r : b.accessed)
+            if (may_alias(w, r))
+                return true;
+    for (auto &w : a.written)
+        for (auto &r : b.written)
+            if (may_alias(w, r))
+                return true;
+    return false;
+}
+
+static bool uses_assigned_vars(const loop_access_info &a, const loop_access_info &b) {
+    for (VarDecl *vd : a.assigned_vars)
+        if (b.referenced_vars.count(vd) > 0 || b.assigned_vars.count(vd) > 0)
+            return true;
+    return false;
+}
+
+/// Can loop b be fused after loop (group) a
+static bool can_fuse_loops(const loop_access_info &a, const loop_access_info &b) {
+
+    if (a.unknown_write || b.unknown_write)
+        return false;
+
+    if ((a.reads_neighbours && b.written.size() > 0) ||
+        (b.reads_neighbours && a.written.size() > 0))
+        return false;
+
+    if (writes_may_alias(a, b) || writes_may_alias(b, a))
+        return false;
+
+    if (uses_assigned_vars(a, b) || uses_assigned_vars(b, a))
+        return false;
+
+    if (a.has_random && b.has_random)
+        return false;
+
+    if (target.vectorize) {
+        if (a.has_conditional || b.has_conditional)
+            return false;
+        std::set<number_type> types = a.field_types;
+        types.insert(b.field_types.begin(), b.field_types.end());
+        if (types.size() > 1)
+            return false;
+    }
+
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/// Find groups of fusable onsites() -loops in the compound statement.
+/// Fills in fused_loop_groups and fused_loops, which VisitStmt() uses
+//////////////////////////////////////////////////////////////////////////////
+
+void TopLevelVisitor::find_fusable_loops(CompoundStmt *CS) {
+
+    if (!cmdline::loop_fusion)
+        return;
+
+    ForStmt *first = nullptr;
+    loop_access_info group;
+    std::string group_parity;
+
+    for (Stmt *st : CS->body()) {
+
+        ForStmt *f = nullptr;
+        if (is_onsites(st))
+            f = cast<ForStmt>(st);
+
+        if (f == nullptr || has_any_pragma_hila(f)) {
+            first = nullptr;
+            continue;
+        }
+
+        CharSourceRange CSR =
+            TheRewriter.getSourceMgr().getImmediateExpansionRange(f->getSourceRange().getBegin());
+        std::string parity = remove_all_whitespace(TheRewriter.getRewrittenText(CSR.getAsRange()));
+
+        loopAccessScanner scanner(*this);
+        scanner.TraverseStmt(f->getBody());
+        scanner.info.has_random = contains_random(f->getBody());
+
+        if (first != nullptr && parity == group_parity && can_fuse_loops(group, scanner.info)) {
+
+            fused_loop_groups[first].push_back(f);
+            fused_loops.insert(f);
+            group.merge(scanner.info);
+
+            if (cmdline::verbosity > 0)
+                reportDiag(DiagnosticsEngine::Level::Remark, f->getSourceRange().getBegin(),
+                           "site loop is fused with the previous loop");
+
+        } else {
+            first = f;
+            group = scanner.info;
+            group_parity = parity;
+        }
+    }
+}
+
+/// Loops with hila pragmas are not fused
+bool TopLevelVisitor::has_any_pragma_hila(Stmt *s) {
+    return has_pragma(s, pragma_hila::NOVECTOR) || has_pragma(s, pragma_hila::ACCESS) ||
+           has_pragma(s, pragma_hila::SAFE) || has_pragma(s, pragma_hila::IN_OMP_PARALLEL_REGION) ||
+           has_pragma(s, pragma_hila::AST_DUMP) || has_pragma(s, pragma_hila::NOFUSE);
+}
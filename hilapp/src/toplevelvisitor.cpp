@@ -981,7 +981,8 @@ void TopLevelVisitor::handle_loop_const_expr_ref(Expr *E, bool is_assign, std::s
 /// "parity" -loops
 ///////////////////////////////////////////////////////////////////////////////
 
-bool TopLevelVisitor::handle_full_loop_stmt(Stmt *ls, bool field_parity_ok) {
+bool TopLevelVisitor::handle_full_loop_stmt(Stmt *ls, bool field_parity_ok,
+                                            const std::vector<Stmt *> &fused_bodies) {
     // init edit buffer
     // Buf.create( &TheRewriter, ls );
 
@@ -997,6 +998,7 @@ bool TopLevelVisitor::handle_full_loop_stmt(Stmt *ls, bool field_parity_ok) {
     global.location.loop = ls->getSourceRange().getBegin();
     loop_info.clear_except_external();
     loop_info.range = ls->getSourceRange();
+    loop_info.fused_bodies = fused_bodies;
     parsing_state.accept_field_parity = field_parity_ok;
 
     // the following is for taking the parity from next elem
@@ -1008,17 +1010,30 @@ bool TopLevelVisitor::handle_full_loop_stmt(Stmt *ls, bool field_parity_ok) {
     // code analysis starts here
     TraverseStmt(ls);
 
+    // fused loops are analysed as if they were consecutive blocks of the same loop
+    for (Stmt *body : fused_bodies) {
+        parsing_state.scope_level = 0;
+        parsing_state.ast_depth = 0;
+        TraverseStmt(body);
+    }
+
     parsing_state.in_loop_body = false;
     parsing_state.ast_depth = 0;
 
     // check and analyze the field expressions
     check_var_info_list();
     check_addrofops_and_refs(ls); // scan through the full loop again
+    for (Stmt *body : fused_bodies)
+        check_addrofops_and_refs(body);
     check_field_ref_list();
     process_loop_functions(); // revisit functions when vars are fully resolved
 
     if (!loop_info.contains_random)
         loop_info.contains_random = contains_random(ls);
+    for (Stmt *body : fused_bodies) {
+        if (!loop_info.contains_random)
+            loop_info.contains_random = contains_random(body);
+    }
 
     // check here also if conditionals are site dependent through var dependence
     // because var_info_list was checked above, once is enough
@@ -1042,6 +1057,7 @@ bool TopLevelVisitor::handle_full_loop_stmt(Stmt *ls, bool field_parity_ok) {
                      comment_string(global.full_loop_text) + "\n", true, true);
 
     global.full_loop_text = "";
+    loop_info.fused_bodies.clear();
 
     // don't go again through the arguments
     parsing_state.skip_children = 1;
@@ -1933,6 +1949,12 @@ bool TopLevelVisitor::VisitStmt(Stmt *s) {
     // Defined as a macro, needs special macro handling
     if (is_onsites(s)) {
 
+        // loop was fused in the previous loop and generated there
+        if (fused_loops.count(s) > 0) {
+            parsing_state.skip_children = 1;
+            return true;
+        }
+
         ForStmt *f = cast<ForStmt>(s);
         SourceLocation startloc = f->getSourceRange().getBegin();
 
@@ -1967,7 +1989,22 @@ bool TopLevelVisitor::VisitStmt(Stmt *s) {
                     // TheRewriter.RemoveText(CSR);
                     writeBuf->remove(CSR);
 
-                    handle_full_loop_stmt(f->getBody(), false);
+                    // and of the loops fused in this one
+                    std::vector<Stmt *> fused_bodies;
+                    auto group = fused_loop_groups.find(s);
+                    if (group != fused_loop_groups.end()) {
+                        for (ForStmt *ff : group->second) {
+                            CharSourceRange fCSR = TheRewriter.getSourceMgr().getImmediateExpansionRange(
+                                ff->getSourceRange().getBegin());
+                            global.full_loop_text += "\n" +
+                                                     TheRewriter.getRewrittenText(fCSR.getAsRange()) +
+                                                     " " + get_stmt_str(ff->getBody());
+                            writeBuf->remove(fCSR);
+                            fused_bodies.push_back(ff->getBody());
+                        }
+                    }
+
+                    handle_full_loop_stmt(f->getBody(), false, fused_bodies);
                     internal_error = false;
                 }
             }
@@ -2011,8 +2048,10 @@ bool TopLevelVisitor::VisitStmt(Stmt *s) {
     }
 
     // And, for correct level for pragma handling - turns to 0 for stmts inside
-    if (isa<CompoundStmt>(s))
+    if (CompoundStmt *CS = dyn_cast<CompoundStmt>(s)) {
         parsing_state.ast_depth = -1;
+        find_fusable_loops(CS);
+    }
 
     Expr *E = dyn_cast<Expr>(s);
 
@@ -2,6 +2,8 @@
 #define TOPLEVELVISITOR_H
 
 #include <string>
+#include <map>
+#include <set>
 #include "clang/AST/AST.h"
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/RecursiveASTVisitor.h"
@@ -48,6 +50,11 @@ class TopLevelVisitor : public GeneralVisitor, public RecursiveASTVisitor<TopLev
         bool loop_function_next;
     } parsing_state;
 
+    // onsites() -loops fused into the preceding loop (loop_fusion.cpp): the loops
+    // by the first loop of the group, and the set of the loops fused away
+    std::map<Stmt *, std::vector<ForStmt *>> fused_loop_groups;
+    std::set<Stmt *> fused_loops;
+
   public:
     TopLevelVisitor(Rewriter &R, ASTContext *C) : GeneralVisitor(R, C) {
         is_top_level = true;
@@ -147,6 +154,10 @@ class TopLevelVisitor : public GeneralVisitor, public RecursiveASTVisitor<TopLev
 
     bool is_onsites(Stmt *s);
 
+    /// Find adjacent onsites() -loops which can be fused
+    void find_fusable_loops(CompoundStmt *CS);
+    bool has_any_pragma_hila(Stmt *s);
+
     bool handle_vector_reference(Stmt *s, bool &is_assign, std::string &assignop, Stmt *assingstmt);
 
     bool is_select_stmt(Stmt *s, Expr **value_expr);
@@ -187,8 +198,10 @@ class TopLevelVisitor : public GeneralVisitor, public RecursiveASTVisitor<TopLev
 
     // void requireGloballyDefined(Expr *e);
 
-    /// Entry point for the full site loop
-    bool handle_full_loop_stmt(Stmt *ls, bool field_parity_ok);
+    /// Entry point for the full site loop.  fused_bodies are the bodies of the
+    /// following loops fused in this loop
+    bool handle_full_loop_stmt(Stmt *ls, bool field_parity_ok,
+                               const std::vector<Stmt *> &fused_bodies = {});
 
     /// Function for each stmt within loop body
     bool handle_loop_body_stmt(Stmt *s);
@@ -144,8 +144,9 @@ class Complex {
     }
 
     inline Complex<T> &random() out_only {
-        re = hila::random();
-        im = hila::random();
+        // hila::random(T &) fills also the lanes of vectorized types
+        hila::random(re);
+        hila::random(im);
         return *this;
     }
 
@@ -156,7 +157,8 @@ class Complex {
      * @return Complex<T>&
      */
     inline Complex<T> &gaussian_random(double width = 1.0) out_only {
-        double d;
+        // for vectorized T d is the vector type, see backend_vector/defs.h
+        std::conditional_t<std::is_arithmetic<T>::value, double, T> d;
         re = hila::gaussrand2(d) * width;
         im = d * width;
         return *this;
@@ -10,6 +10,18 @@
 template <typename G>
 class Algebra;
 
+template <int N, typename T>
+class SU;
+
+namespace hila {
+/// is_SU_matrix<T>::value is true if T is SU<N,type>
+template <typename T>
+struct is_SU_matrix : std::false_type {};
+
+template <int N, typename T>
+struct is_SU_matrix<SU<N, T>> : std::true_type {};
+} // namespace hila
+
 /**
  * @brief Class for SU(N) matrix
  *
@@ -89,6 +101,19 @@ class SU : public Matrix_t<N, N, Complex<T>, SU<N, T>> {
         return *this;
     }
 
+    /// Reconstruct the last row from the first N-1 rows (used in compact storage).
+    /// For a special unitary matrix the last row is the complex conjugate
+    /// of its cofactors, which depend only on the other rows
+    const SU &reconstruct_last_row() {
+        T parity = ((N - 1) % 2 == 0) ? 1 : -1;
+        for (int c = 0; c < N; c++) {
+            Matrix<N - 1, N - 1, Complex<T>> minor = Minor(*this, N - 1, c);
+            this->e(N - 1, c) = parity * ::conj(det(minor));
+            parity = -parity;
+        }
+        return *this;
+    }
+
 
     const SU &random(int nhits = 16) out_only {
 
@@ -11,6 +11,7 @@
 
 #include <sstream>
 #include <iostream>
+#include <sys/time.h>
 
 constexpr int CG_DEFAULT_MAXITERS = 10000;
 constexpr double CG_DEFAULT_ACCURACY = 1e-12;
@@ -104,4 +105,139 @@ template <typename Op> class CG {
     }
 };
 
+
+///////////////////////////////////////////////////////
+/// Pipelined conjugate gradient (Ghysels and Vanroose): the same
+/// solution as CG, but the recurrences are rearranged so that the two inner
+/// products of an iteration are done in one non-blocking reduction,
+/// which is in flight while the operator is applied.  Use instead of CG when
+/// the global reductions dominate, i.e. on a large number of ranks.
+///
+/// Needs 4 more fields than CG.  The recurrence of the residual is replaced with
+/// the true residual every PIPELINED_CG_REPLACE iterations to keep the accuracy.
+///////////////////////////////////////////////////////
+
+constexpr int PIPELINED_CG_REPLACE = 50;
+
+template <typename Op> class PipelinedCG {
+  private:
+    // The operator to invert
+    Op &M;
+    // desired relative accuracy
+    double accuracy = CG_DEFAULT_ACCURACY;
+    // maximum number of iterations
+    double maxiters = CG_DEFAULT_MAXITERS;
+
+    // apply M^dagger M, tmp is work space
+    template <typename F> void apply_normal(F &in, F &out, F &tmp) {
+        M.apply(in, tmp);
+        M.dagger(tmp, out);
+    }
+
+  public:
+    /// Get the type the operator applies to
+    using vector_type = typename Op::vector_type;
+
+    /// Constructor: initialize the operator
+    PipelinedCG(Op &op) : M(op){};
+    /// Constructor: operator and accuracy
+    PipelinedCG(Op &op, double _accuracy) : M(op) { accuracy = _accuracy; };
+    /// Constructor: operator, accuracy and maximum number of iterations
+    PipelinedCG(Op &op, double _accuracy, int _maxiters) : M(op) {
+        accuracy = _accuracy;
+        maxiters = _maxiters;
+    };
+
+    /// Solve (M^dagger M) out = in, out is the starting guess
+    void apply(Field<vector_type> &in, Field<vector_type> &out) {
+        int i;
+        struct timeval start, end;
+        // r: residual, w = A r, p: search direction, s = A p, z = A s, q = A w
+        Field<vector_type> r, w, p, s, z, q, tmp;
+        for (auto f : {&r, &w, &p, &s, &z, &q, &tmp})
+            f->copy_boundary_condition(in);
+        out.copy_boundary_condition(in);
+        double gamma = 0, gamma_old = 0, delta, alpha = 0, beta;
+        double target_rr, source_norm = 0;
+
+        // gamma = (r,r) and delta = (w,r) in one reduction
+        ReductionVector<double> rv(2);
+        rv.allreduce(true).nonblocking(true);
+
+        gettimeofday(&start, NULL);
+
+        onsites(M.par) { source_norm += squarenorm(in[X]); }
+
+        target_rr = accuracy * accuracy * source_norm;
+
+        apply_normal(out, r, tmp);
+        onsites(M.par) r[X] = in[X] - r[X];
+        apply_normal(r, w, tmp);
+
+        for (i = 0; i < maxiters; i++) {
+            rv = 0;
+            onsites(M.par) {
+                rv[0] += squarenorm(r[X]);
+                // real part of (w,r) with squarenorm only, works for all CG types
+                rv[1] += 0.25 * (squarenorm(w[X] + r[X]) - squarenorm(w[X] - r[X]));
+            }
+
+            // the reduction is in flight while the operator is applied
+            apply_normal(w, q, tmp);
+            rv.wait();
+
+            gamma = rv[0];
+            delta = rv[1];
+#ifdef DEBUG_CG
+            hila::out0 << "Pipelined CG step " << i << ", residue " << sqrt(gamma / target_rr)
+                       << "\n";
+#endif
+            if (gamma < target_rr)
+                break;
+
+            if (i == 0) {
+                beta = 0;
+                alpha = gamma / delta;
+                onsites(M.par) {
+                    z[X] = q[X];
+                    s[X] = w[X];
+                    p[X] = r[X];
+                }
+            } else {
+                beta = gamma / gamma_old;
+                alpha = gamma / (delta - beta * gamma / alpha);
+                onsites(M.par) {
+                    z[X] = q[X] + beta * z[X];
+                    s[X] = w[X] + beta * s[X];
+                    p[X] = r[X] + beta * p[X];
+                }
+            }
+
+            if ((i + 1) % PIPELINED_CG_REPLACE == 0) {
+                // replace the recurrences with the true values
+                onsites(M.par) out[X] = out[X] + alpha * p[X];
+                apply_normal(out, r, tmp);
+                onsites(M.par) r[X] = in[X] - r[X];
+                apply_normal(r, w, tmp);
+                apply_normal(p, s, tmp);
+                apply_normal(s, z, tmp);
+            } else {
+                onsites(M.par) {
+                    out[X] = out[X] + alpha * p[X];
+                    r[X] = r[X] - alpha * s[X];
+                    w[X] = w[X] - alpha * z[X];
+                }
+            }
+            gamma_old = gamma;
+        }
+
+        gettimeofday(&end, NULL);
+        double timing =
+            1e-3 * (end.tv_usec - start.tv_usec) + 1e3 * (end.tv_sec - start.tv_sec);
+
+        hila::out0 << "Pipelined Conjugate Gradient: " << i << " steps in " << timing << "ms, ";
+        hila::out0 << "relative residue:" << gamma / source_norm << "\n";
+    }
+};
+
 #endif
@@ -6,6 +6,7 @@
 #include "../datatypes/matrix.h"
 #include "../datatypes/sun.h"
 #include "../plumbing/field.h"
+#include "../plumbing/gather_batch.h"
 #include "../../libraries/hmc/gauge_field.h"
 
 template <typename vector> Field<vector> staggered_dirac_temp[NDIM];
@@ -47,16 +48,22 @@ void dirac_staggered_hop(const Field<mtype> *gauge, const Field<vtype> &v_in,
                          Field<vtype> &v_out, Field<double> (&staggered_eta)[NDIM],
                          Parity par, int sign) {
     Field<vtype>(&vtemp)[NDIM] = staggered_dirac_temp<vtype>;
+
+    // Start the v_in gathers first, one message per neighbour rank, so that they
+    // proceed while vtemp is computed
+    hila::gather_batch v_gathers, vtemp_gathers;
     foralldir(dir) {
         vtemp[dir].copy_boundary_condition(v_in);
-        v_in.start_gather(dir, par);
+        v_gathers.add(v_in, dir, par);
     }
+    v_gathers.start();
 
     // First multiply the by conjugate before communicating the vector
     foralldir(dir) {
         vtemp[dir][opp_parity(par)] = gauge[dir][X].adjoint() * v_in[X];
-        vtemp[dir].start_gather(-dir, par);
+        vtemp_gathers.add(vtemp[dir], -dir, par);
     }
+    vtemp_gathers.start();
 
     // Run neighbour gathers and multiplications
     foralldir(dir) {
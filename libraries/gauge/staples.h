@@ -16,13 +16,16 @@ void staplesum(const GaugeField<T> &U, Field<T> &staples, Direction d1, Parity p
 
     Field<T> lower;
 
-    bool first = true;
+    // anticipate that these are needed, all in one batch
+    // not really necessary, but may be faster
+    hila::gather_batch gathers;
     foralldir(d2) if (d2 != d1) {
+        gathers.add(U[d2], d1, ALL).add(U[d1], d2, par);
+    }
+    gathers.start();
 
-        // anticipate that these are needed
-        // not really necessary, but may be faster
-        U[d2].start_gather(d1, ALL);
-        U[d1].start_gather(d2, par);
+    bool first = true;
+    foralldir(d2) if (d2 != d1) {
 
         // calculate first lower 'U' of the staple sum
         // do it on opp parity
@@ -83,6 +83,12 @@ HILA_OBJECTS = \
 	build/timing.o \
 	build/test_gathers.o \
 	build/com_mpi.o \
+	build/shard_io.o \
+	build/checksum.o \
+	build/lime_io.o \
+	build/mapped_config.o \
+	build/gather_batch.o \
+	build/element_query.o \
 	build/fft.o
 
 # Remvoved com_simple.o, require MPI
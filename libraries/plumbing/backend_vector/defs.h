@@ -376,61 +376,127 @@ inline Vec4i operator%(const Vec4i &lhs, const int &rhs) {
     return r;
 }
 
-// Random numbers
-// Since you cannot specialize by return type,
-// it needs to be a struct...
-
-#ifdef THESE_ARE_NOT_NEEDED_BUT_LEAVE_HERE
-
-#if VECTOR_SIZE == 32
-template <typename T>
-inline auto hila_random_vector() {
-    Vec8f r;
-    float tvec[8];
-    for (int i = 0; i < 8; i++) {
-        tvec[i] = mersenne();
+/////////////////////////////////////////////////////////////////////////
+/// Vectorized random numbers.  Each lane has its own xoshiro256+ generator
+/// (Blackman and Vigna), the 4 64-bit state words of 4 lanes are kept in Vec4uq
+/// registers.  With OpenMP each thread has its own state, see random.cpp.
+///
+/// hila::random(v), hila::gaussian_random(v) and hila::gaussrand2(v) below fill
+/// all lanes of v with independent numbers.  Site loops with random numbers are
+/// vectorized only with hilapp option -vectorize-random, which replaces
+/// hila::random() with hila::random_vector<N>().  The numbers are not the same
+/// as in non-vectorized code.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef HILAPP
+
+namespace hila {
+
+struct vector_rng_state {
+    Vec4uq s[4];
+
+    /// next 4 random 64-bit words, one for each lane
+    inline Vec4uq next() {
+        Vec4uq result = s[0] + s[3];
+        Vec4uq t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = (s[3] << 45) | (s[3] >> 19);
+        return result;
     }
-    r.load(&(tvec[0]));
-    return r;
 };
 
+/// generator of the calling thread, in random.cpp
+vector_rng_state &thread_vector_rng();
+
+/// Uniform random numbers in [0,1) on all lanes.  The high bits of the words are
+/// put in the mantissa of a number in [1,2)
+template <typename Vtype>
+inline Vtype uniform_vector();
+
 template <>
-inline auto hila_random_vector<double>() {
-    Vec4d r;
-    double tvec[4];
-    for (int i = 0; i < 4; i++) {
-        tvec[i] = mersenne();
-    }
-    r.load(&(tvec[0]));
-    return r;
-};
+inline Vec4d uniform_vector<Vec4d>() {
+    Vec4uq x = thread_vector_rng().next();
+    return reinterpret_d((x >> 12) | 0x3FF0000000000000ULL) - 1.0;
+}
 
-#elif VECTOR_SIZE == 64
+template <>
+inline Vec8f uniform_vector<Vec8f>() {
+    Vec8ui x = Vec8ui(__m256i(thread_vector_rng().next()));
+    return reinterpret_f((x >> 9) | 0x3F800000U) - 1.0f;
+}
 
-template <typename T>
-inline auto hila_random_vector() {
-    Vec16f r;
-    float tvec[16];
-    for (int i = 0; i < 16; i++) {
-        tvec[i] = mersenne();
-    }
-    r.load(&(tvec[0]));
-    return r;
-};
+template <>
+inline Vec8d uniform_vector<Vec8d>() {
+    Vec4d lo = uniform_vector<Vec4d>();
+    Vec4d hi = uniform_vector<Vec4d>();
+    return Vec8d(lo, hi);
+}
 
 template <>
-inline auto hila_random_vector<double>() {
-    Vec8d r;
-    double tvec[8];
-    for (int i = 0; i < 8; i++) {
-        tvec[i] = mersenne();
+inline Vec16f uniform_vector<Vec16f>() {
+    Vec8f lo = uniform_vector<Vec8f>();
+    Vec8f hi = uniform_vector<Vec8f>();
+    return Vec16f(lo, hi);
+}
+
+/// Box-Muller on all lanes, as hila::gaussrand2()
+template <typename Vtype>
+inline Vtype gaussrand2_vector(Vtype &out2) {
+    Vtype phi = uniform_vector<Vtype>() * (2.0 * M_PI);
+    // 1 - u is in (0,1]
+    Vtype r = sqrt(::log(1.0 - uniform_vector<Vtype>()) * (-2.0));
+    Vtype c;
+    Vtype s = sincos(&c, phi);
+    out2 = r * c;
+    return r * s;
+}
+
+/// hila::random_vector<N>() returns a vector of N uniform random numbers in [0,1),
+/// of the vector type with N lanes used in the loops (double or float).
+template <int N>
+inline auto random_vector() {
+    if constexpr (N * sizeof(double) == VECTOR_SIZE) {
+        if constexpr (N == 4)
+            return uniform_vector<Vec4d>();
+        else
+            return uniform_vector<Vec8d>();
+    } else {
+        if constexpr (N == 8)
+            return uniform_vector<Vec8f>();
+        else
+            return uniform_vector<Vec16f>();
     }
-    r.load(&(tvec[0]));
-    return r;
-};
+}
 
-#endif // NOT NEEDED
+// Overloads of hila::random(T &), hila::gaussian_random(T &, double) and
+// hila::gaussrand2(T &) in random.h for the vector types
+
+#define HILA_VECTOR_RANDOM_FUNCTIONS(Vtype)                                                        \
+    inline Vtype random(Vtype &val) {                                                              \
+        val = uniform_vector<Vtype>();                                                             \
+        return val;                                                                                \
+    }                                                                                              \
+    inline Vtype gaussrand2(Vtype &out2) {                                                         \
+        return gaussrand2_vector(out2);                                                            \
+    }                                                                                              \
+    inline Vtype gaussian_random(Vtype &val, double w = 1.0) {                                     \
+        Vtype second;                                                                              \
+        val = gaussrand2_vector(second) * w;                                                       \
+        return val;                                                                                \
+    }
 
+HILA_VECTOR_RANDOM_FUNCTIONS(Vec4d)
+HILA_VECTOR_RANDOM_FUNCTIONS(Vec8f)
+HILA_VECTOR_RANDOM_FUNCTIONS(Vec8d)
+HILA_VECTOR_RANDOM_FUNCTIONS(Vec16f)
+
+#undef HILA_VECTOR_RANDOM_FUNCTIONS
+
+} // namespace hila
 
 #endif // not HILAPP
 
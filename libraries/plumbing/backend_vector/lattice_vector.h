@@ -62,6 +62,9 @@ struct vectorized_lattice_struct {
     size_t alloc_size;
     /// A wait array for the vectorized field
     unsigned char *RESTRICT vec_wait_arr_;
+    /// interior (0) and boundary (1) vector sites, even sites first
+    std::vector<unsigned> vec_wait_sites_[2];
+    unsigned vec_wait_sites_even_[2];
 
     /// Check if this is the first subnode
     bool is_on_first_subnode(CoordinateVector v) {
@@ -355,6 +358,33 @@ struct vectorized_lattice_struct {
                 }
             }
         }
+
+        // interior and boundary site lists for wait_site_list().  Even vector sites
+        // are the first half, thus increasing index gives even sites first
+        for (int b = 0; b < 2; b++) {
+            vec_wait_sites_[b].clear();
+            vec_wait_sites_even_[b] = 0;
+            for (unsigned i = 0; i < v_sites; i++) {
+                if ((vec_wait_arr_[i] != 0) == (b == 1)) {
+                    vec_wait_sites_[b].push_back(i);
+                    if (i < v_sites / 2)
+                        vec_wait_sites_even_[b]++;
+                }
+            }
+            vec_wait_sites_[b].shrink_to_fit();
+        }
+    }
+
+    /// Vector sites which do not (boundary == false) or do (boundary == true) need
+    /// halo data, of parity par.  Used by the -wait-site-lists loops of hilapp
+    lattice_struct::site_list wait_site_list(::Parity par, bool boundary) const {
+        const std::vector<unsigned> &l = vec_wait_sites_[boundary ? 1 : 0];
+        unsigned n_even = vec_wait_sites_even_[boundary ? 1 : 0];
+        if (par == EVEN)
+            return {l.data(), n_even};
+        if (par == ODD)
+            return {l.data() + n_even, (unsigned)l.size() - n_even};
+        return {l.data(), (unsigned)l.size()};
     }
 
     /////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,92 @@
+#include "plumbing/defs.h"
+#include "plumbing/lattice.h"
+#include "plumbing/com_mpi.h"
+#include "plumbing/checksum.h"
+
+//////////////////////////////////////////////////////////////////
+/// Checksums of lattice data - see checksum.h
+//////////////////////////////////////////////////////////////////
+
+namespace hila {
+
+/////////////////////////////////////////////////////////////////
+/// CRC32, table driven, zlib/ethernet polynomial
+
+uint32_t crc32(uint32_t crc, const void *data, size_t n) {
+
+    static const std::array<uint32_t, 256> table = []() {
+        std::array<uint32_t, 256> t;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xedb88320U ^ (c >> 1) : (c >> 1);
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++)
+        crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static inline uint32_t rotate_left(uint32_t x, int k) {
+    return k == 0 ? x : (x << k) | (x >> (32 - k));
+}
+
+void site_checksum::add(int64_t r, const void *data, size_t size) {
+    r += index_offset;
+    uint32_t crc = hila::crc32(0, data, size);
+    a ^= rotate_left(crc, r % 29);
+    b ^= rotate_left(crc, r % 31);
+}
+
+void site_checksum::add_node_block(const void *buffer, size_t element_size) {
+
+    const char *p = static_cast<const char *>(buffer);
+    const CoordinateVector nmin = lattice.mynode.min;
+    const CoordinateVector nsize = lattice.mynode.size;
+    const CoordinateVector lsize = lattice.size();
+    const int64_t nsites = lattice.mynode.volume();
+    const int64_t offset = index_offset;
+
+    uint32_t sa = 0, sb = 0;
+
+#ifdef OPENMP
+#pragma omp parallel for reduction(^ : sa, sb)
+#endif
+    for (int64_t i = 0; i < nsites; i++) {
+        // global index of the local site i
+        int64_t rem = i, r = 0, mul = 1;
+        for (int d = 0; d < NDIM; d++) {
+            r += (nmin[d] + rem % nsize[d]) * mul;
+            rem /= nsize[d];
+            mul *= lsize[d];
+        }
+        r += offset;
+
+        uint32_t crc = hila::crc32(0, p + i * element_size, element_size);
+        sa ^= rotate_left(crc, r % 29);
+        sb ^= rotate_left(crc, r % 31);
+    }
+
+    a ^= sa;
+    b ^= sb;
+}
+
+void site_checksum::reduce() {
+
+    if (hila::check_input)
+        return;
+
+    uint32_t s[2] = {a, b}, r[2];
+    reduction_timer.start();
+    MPI_Allreduce(s, r, 2, MPI_UNSIGNED, MPI_BXOR, lattice.mpi_comm_lat);
+    reduction_timer.stop();
+    a = r[0];
+    b = r[1];
+}
+
+} // namespace hila
@@ -0,0 +1,44 @@
+#ifndef CHECKSUM_H_
+#define CHECKSUM_H_
+
+#include "plumbing/defs.h"
+
+namespace hila {
+
+/// CRC32 checksum (zlib polynomial) of n bytes, continuing from crc (0 to start)
+uint32_t crc32(uint32_t crc, const void *data, size_t n);
+
+/// Site order independent checksum of lattice data, computed as in SciDAC/ILDG files:
+/// the CRC32 of the data of each site is rotated left by r % 29 and r % 31, where r is
+/// the global lexicographic index of the site (x fastest), and xor'ed to sums a and b.
+/// Each rank accumulates its own sites and the results are combined with one reduction,
+/// so no gather or extra pass over the file is needed.
+class site_checksum {
+  public:
+    uint32_t a = 0, b = 0;
+
+    /// Offset added to the site index.  For files with several fields use
+    /// index_offset = (field number) * lattice.volume()
+    int64_t index_offset = 0;
+
+    /// add the data of site with global lexicographic index r
+    void add(int64_t r, const void *data, size_t size);
+
+    /// add node-local data, element_size bytes per site, ordered as in
+    /// Field::copy_local_data()
+    void add_node_block(const void *buffer, size_t element_size);
+
+    /// xor-combine the checksums of all ranks, result on all ranks. Collective
+    void reduce();
+
+    bool operator==(const site_checksum &rhs) const {
+        return a == rhs.a && b == rhs.b;
+    }
+    bool operator!=(const site_checksum &rhs) const {
+        return !(*this == rhs);
+    }
+};
+
+} // namespace hila
+
+#endif
@@ -19,110 +19,116 @@ hila::timer send_timer("MPI send field");
 hila::timer cancel_send_timer("MPI cancel send");
 hila::timer cancel_receive_timer("MPI cancel receive");
 hila::timer partition_sync_timer("partition sync");
+hila::timer mpi_io_timer("MPI-IO");
 
 // let us house the partitions-struct here
 
 hila::partitions_struct hila::partitions;
 
+bool hila::reduced_precision_halo_on = false;
+
 /* Keep track of whether MPI has been initialized */
 static bool mpi_initialized = false;
 
 ////////////////////////////////////////////////////////////
-/// Reductions: do automatic coalescing of reductions
-/// if the type is float or double
+/// Reductions: do automatic coalescing of reductions ending in the same site loop.
+/// Reductions with the same number type, operation and allreduce status are packed
+/// in one buffer and done in one collective in hila_reduce_sums().
 /// These functions should not be called "by hand"
 
-// buffers - first vector holds the reduction buffer,
-// second the pointers to where distribute results
-static std::vector<double> double_reduction_buffer;
-static std::vector<double *> double_reduction_ptrs;
-static int n_double = 0;
-
-static std::vector<float> float_reduction_buffer;
-static std::vector<float *> float_reduction_ptrs;
-static int n_float = 0;
+// one buffer for each kind of reduction: the values to reduce and the
+// pointers (with lengths) to where distribute results
+struct fused_reduction_group {
+    MPI_Datatype dtype;
+    MPI_Op op;
+    bool allreduce;
+    int scalar_size;
+    std::vector<char> buffer, work;
+    std::vector<std::pair<char *, size_t>> targets;
+};
+static std::vector<fused_reduction_group> fused_reductions;
+
+// true between hila::start_fused_reductions() and hila_reduce_sums()
+static bool fused_reductions_on = false;
 
 // static var holding the allreduce state
 static bool allreduce_on = true;
 
-void hila_reduce_double_setup(double *d, int n) {
-
-    // ensure there's enough space
-    if (n + n_double > double_reduction_buffer.size()) {
-        double_reduction_buffer.resize(n + n_double + 2);
-        double_reduction_ptrs.resize(n + n_double + 2);
-    }
-
-    for (int i = 0; i < n; i++) {
-        double_reduction_buffer[n_double + i] = d[i];
-        double_reduction_ptrs[n_double + i] = d + i;
-    }
+void hila::start_fused_reductions() {
+    fused_reductions_on = true;
+}
 
-    n_double += n;
+bool hila::is_fused_reduction() {
+    return fused_reductions_on;
 }
 
-void hila_reduce_float_setup(float *d, int n) {
+void hila::fused_reduction_setup(void *ptr, int count, MPI_Datatype dtype, MPI_Op op,
+                                 bool allreduce) {
 
-    // ensure there's enough space
-    if (n + n_float > float_reduction_buffer.size()) {
-        float_reduction_buffer.resize(n + n_float + 2);
-        float_reduction_ptrs.resize(n + n_float + 2);
+    fused_reduction_group *g = nullptr;
+    for (auto &fg : fused_reductions) {
+        if (fg.dtype == dtype && fg.op == op && fg.allreduce == allreduce) {
+            g = &fg;
+            break;
+        }
     }
-
-    for (int i = 0; i < n; i++) {
-        float_reduction_buffer[n_float + i] = d[i];
-        float_reduction_ptrs[n_float + i] = d + i;
+    if (g == nullptr) {
+        fused_reductions.emplace_back();
+        g = &fused_reductions.back();
+        g->dtype = dtype;
+        g->op = op;
+        g->allreduce = allreduce;
+        MPI_Type_size(dtype, &g->scalar_size);
     }
 
-    n_float += n;
+    size_t bytes = (size_t)count * g->scalar_size;
+    size_t pos = g->buffer.size();
+    g->buffer.resize(pos + bytes);
+    std::memcpy(g->buffer.data() + pos, ptr, bytes);
+    g->targets.push_back({(char *)ptr, bytes});
 }
 
-void hila_reduce_sums() {
-
-    if (n_double > 0) {
-        double work[n_double];
-
-        reduction_timer.start();
+void hila_reduce_double_setup(double *d, int n) {
+    hila::fused_reduction_setup(d, n, MPI_DOUBLE, MPI_SUM, allreduce_on);
+}
 
-        if (allreduce_on) {
-            MPI_Allreduce((void *)double_reduction_buffer.data(), work, n_double,
-                          MPI_DOUBLE, MPI_SUM, lattice.mpi_comm_lat);
-            for (int i = 0; i < n_double; i++)
-                *(double_reduction_ptrs[i]) = work[i];
+void hila_reduce_float_setup(float *d, int n) {
+    hila::fused_reduction_setup(d, n, MPI_FLOAT, MPI_SUM, allreduce_on);
+}
 
-        } else {
-            MPI_Reduce((void *)double_reduction_buffer.data(), work, n_double,
-                       MPI_DOUBLE, MPI_SUM, 0, lattice.mpi_comm_lat);
-            if (hila::myrank() == 0)
-                for (int i = 0; i < n_double; i++)
-                    *(double_reduction_ptrs[i]) = work[i];
-        }
+void hila_reduce_sums() {
 
-        n_double = 0;
+    fused_reductions_on = false;
 
-        reduction_timer.stop();
-    }
+    // groups are kept, only the buffers are emptied.  The groups are in the same
+    // order on all ranks
+    for (auto &g : fused_reductions) {
+        if (g.targets.empty())
+            continue;
 
-    if (n_float > 0) {
-        float work[n_float];
+        int n = g.buffer.size() / g.scalar_size;
+        g.work.resize(g.buffer.size());
 
         reduction_timer.start();
 
-        if (allreduce_on) {
-            MPI_Allreduce((void *)float_reduction_buffer.data(), work, n_float,
-                          MPI_FLOAT, MPI_SUM, lattice.mpi_comm_lat);
-            for (int i = 0; i < n_float; i++)
-                *(float_reduction_ptrs[i]) = work[i];
-
+        if (g.allreduce) {
+            MPI_Allreduce((void *)g.buffer.data(), (void *)g.work.data(), n, g.dtype, g.op,
+                          lattice.mpi_comm_lat);
         } else {
-            MPI_Reduce((void *)float_reduction_buffer.data(), work, n_float, MPI_FLOAT,
-                       MPI_SUM, 0, lattice.mpi_comm_lat);
-            if (hila::myrank() == 0)
-                for (int i = 0; i < n_float; i++)
-                    *(float_reduction_ptrs[i]) = work[i];
+            MPI_Reduce((void *)g.buffer.data(), (void *)g.work.data(), n, g.dtype, g.op, 0,
+                       lattice.mpi_comm_lat);
         }
 
-        n_float = 0;
+        if (g.allreduce || hila::myrank() == 0) {
+            size_t pos = 0;
+            for (auto &t : g.targets) {
+                std::memcpy(t.first, g.work.data() + pos, t.second);
+                pos += t.second;
+            }
+        }
+
+        g.buffer.clear();
+        g.targets.clear();
 
         reduction_timer.stop();
     }
@@ -140,6 +146,126 @@ bool hila::get_allreduce() {
 ////////////////////////////////////////////////////////////////////////
 
 
+#ifdef SHARED_MEMORY_HALO
+
+////////////////////////////////////////////////////////////
+/// Node-shared memory window for the halo exchange between ranks on the same
+/// host.  Each rank owns a pool of SHARED_HALO_POOL_MB in the window, from which the
+/// send buffers of the fields are allocated.  The window is kept in a lock_all
+/// epoch all the time, synchronization goes through the gather messages
+
+static MPI_Comm shared_comm = MPI_COMM_NULL;
+static MPI_Win shared_win;
+static std::vector<char *> shared_base; // pool of each lattice rank, nullptr if off-host
+static std::map<int64_t, size_t> shared_free_blocks; // offset -> size
+
+static size_t shared_block_size(size_t bytes) {
+    return (bytes + 63) / 64 * 64;
+}
+
+void hila::setup_shared_halo() {
+    if (shared_comm != MPI_COMM_NULL)
+        return;
+
+    MPI_Comm_split_type(lattice.mpi_comm_lat, MPI_COMM_TYPE_SHARED, hila::myrank(),
+                        MPI_INFO_NULL, &shared_comm);
+
+    size_t pool_size = (size_t)SHARED_HALO_POOL_MB << 20;
+    char *mybase;
+    MPI_Win_allocate_shared(pool_size, 1, MPI_INFO_NULL, shared_comm, &mybase, &shared_win);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, shared_win);
+
+    // translate lattice ranks to the ranks of the shared communicator
+    int n = lattice.n_nodes();
+    std::vector<int> ranks(n), shared_ranks(n);
+    for (int i = 0; i < n; i++)
+        ranks[i] = i;
+
+    MPI_Group lattice_group, shared_group;
+    MPI_Comm_group(lattice.mpi_comm_lat, &lattice_group);
+    MPI_Comm_group(shared_comm, &shared_group);
+    MPI_Group_translate_ranks(lattice_group, n, ranks.data(), shared_group, shared_ranks.data());
+    MPI_Group_free(&lattice_group);
+    MPI_Group_free(&shared_group);
+
+    shared_base.assign(n, nullptr);
+    for (int i = 0; i < n; i++) {
+        if (shared_ranks[i] != MPI_UNDEFINED) {
+            MPI_Aint size;
+            int disp_unit;
+            char *base;
+            MPI_Win_shared_query(shared_win, shared_ranks[i], &size, &disp_unit, &base);
+            shared_base[i] = base;
+        }
+    }
+
+    shared_free_blocks.clear();
+    shared_free_blocks[0] = pool_size;
+
+    int n_shared;
+    MPI_Comm_size(shared_comm, &n_shared);
+    hila::out0 << "Shared memory halo exchange: " << n_shared << " ranks on host of rank 0, "
+               << SHARED_HALO_POOL_MB << " MB pool per rank\n";
+}
+
+static void finish_shared_halo() {
+    if (shared_comm == MPI_COMM_NULL)
+        return;
+    MPI_Win_unlock_all(shared_win);
+    MPI_Win_free(&shared_win);
+    MPI_Comm_free(&shared_comm);
+    shared_comm = MPI_COMM_NULL;
+    shared_base.clear();
+}
+
+char *hila::shared_halo_base(int rank) {
+    if (shared_base.empty())
+        return nullptr;
+    return shared_base[rank];
+}
+
+int64_t hila::shared_halo_alloc(size_t bytes) {
+    bytes = shared_block_size(bytes);
+    for (auto it = shared_free_blocks.begin(); it != shared_free_blocks.end(); ++it) {
+        if (it->second >= bytes) {
+            int64_t offset = it->first;
+            size_t left = it->second - bytes;
+            shared_free_blocks.erase(it);
+            if (left > 0)
+                shared_free_blocks[offset + bytes] = left;
+            return offset;
+        }
+    }
+    return -1;
+}
+
+void hila::shared_halo_free(int64_t offset, size_t bytes) {
+    if (shared_base.empty())
+        return;
+
+    auto it = shared_free_blocks.emplace(offset, shared_block_size(bytes)).first;
+
+    // merge with the following and the preceding free block
+    auto next = std::next(it);
+    if (next != shared_free_blocks.end() && it->first + it->second == next->first) {
+        it->second += next->second;
+        shared_free_blocks.erase(next);
+    }
+    if (it != shared_free_blocks.begin()) {
+        auto prev = std::prev(it);
+        if (prev->first + prev->second == it->first) {
+            prev->second += it->second;
+            shared_free_blocks.erase(it);
+        }
+    }
+}
+
+void hila::shared_halo_sync() {
+    MPI_Win_sync(shared_win);
+}
+
+#endif
+
 /* Machine initialization */
 #include <sys/types.h>
 void initialize_communications(int &argc, char ***argv) {
@@ -172,6 +298,59 @@ void initialize_communications(int &argc, char ***argv) {
     }
 }
 
+////////////////////////////////////////////////////////////////////////
+/// Job queue of the partitions: counter of the next job at rank 0 of MPI_COMM_WORLD,
+/// taken with an atomic MPI_Fetch_and_op.  No rank needs to act as the dispatcher.
+
+static MPI_Win job_win;
+static int64_t *job_counter = nullptr;
+static bool job_queue_on = false;
+static int64_t local_job_counter = 0;
+
+static void setup_job_queue() {
+    int world_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+    MPI_Aint size = (world_rank == 0) ? sizeof(int64_t) : 0;
+
+    MPI_Win_allocate(size, sizeof(int64_t), MPI_INFO_NULL, MPI_COMM_WORLD, &job_counter,
+                     &job_win);
+    if (world_rank == 0) {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, job_win);
+        *job_counter = 0;
+        MPI_Win_unlock(0, job_win);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    job_queue_on = true;
+}
+
+static void finish_job_queue() {
+    if (job_queue_on)
+        MPI_Win_free(&job_win);
+    job_queue_on = false;
+}
+
+int64_t hila::partitions_struct::next_job(int64_t n_jobs) {
+
+    if (hila::check_input)
+        return -1;
+
+    int64_t job;
+    if (!job_queue_on) {
+        // no partitions, all ranks count in the same way
+        job = local_job_counter++;
+    } else {
+        if (hila::myrank() == 0) {
+            const int64_t one = 1;
+            MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, job_win);
+            MPI_Fetch_and_op(&one, &job, MPI_INT64_T, 0, 0, MPI_SUM, job_win);
+            MPI_Win_unlock(0, job_win);
+        }
+        hila::broadcast(job);
+    }
+    return (job < n_jobs) ? job : -1;
+}
+
+
 // check if MPI is on
 bool is_comm_initialized(void) {
     return mpi_initialized;
@@ -191,6 +370,11 @@ void finish_communications() {
     mpi_initialized = false;
     hila::about_to_finish = true;
 
+#ifdef SHARED_MEMORY_HALO
+    finish_shared_halo();
+#endif
+    finish_job_queue();
+
     MPI_Finalize();
 }
 
@@ -252,6 +436,13 @@ int hila::number_of_nodes() {
     return (nodes);
 }
 
+/// MPI_Iprobe runs the progress engine of the MPI library, moving the data of the
+/// nonblocking messages.  It does not touch the requests, so it can be called any time
+void hila::progress_comms() {
+    int flag;
+    MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, lattice.mpi_comm_lat, &flag, MPI_STATUS_IGNORE);
+}
+
 void hila::synchronize() {
     synchronize_timer.start();
     hila::synchronize_threads();
@@ -274,6 +465,44 @@ int get_next_msg_tag() {
     return tag;
 }
 
+// Acknowledgement tags of the shared memory halo exchange: one for each cyclic tag,
+// in a range of their own so that notifications and acknowledgements never match
+// each other
+
+#define SHARED_ACK_TAG_MIN (MSG_TAG_MAX + 1)
+#define SHARED_ACK_TAG_MAX (SHARED_ACK_TAG_MIN + MSG_TAG_MAX - MSG_TAG_MIN)
+
+int get_shared_ack_tag(int tag) {
+    return tag - MSG_TAG_MIN + SHARED_ACK_TAG_MIN;
+}
+
+// Persistent gather tags are above these; 32767 is the smallest upper bound
+// for tags allowed by the standard.  Released blocks are reused in LIFO order
+
+#define PERSISTENT_TAG_MIN (SHARED_ACK_TAG_MAX + 1)
+#define PERSISTENT_TAG_MAX 32767
+
+static std::vector<int> free_persistent_tags;
+static int next_persistent_tag = PERSISTENT_TAG_MIN;
+
+int get_persistent_tag_base() {
+    if (!free_persistent_tags.empty()) {
+        int base = free_persistent_tags.back();
+        free_persistent_tags.pop_back();
+        return base;
+    }
+    if (next_persistent_tag + 3 * NDIRS - 1 > PERSISTENT_TAG_MAX)
+        return -1;
+    int base = next_persistent_tag;
+    next_persistent_tag += 3 * NDIRS;
+    return base;
+}
+
+void release_persistent_tag_base(int base) {
+    if (base >= 0)
+        free_persistent_tags.push_back(base);
+}
+
 
 // Split the communicator to subvolumes, using MPI_Comm_split
 // New MPI_Comm is the global mpi_comm_lat
@@ -292,8 +521,124 @@ void split_into_partitions(int this_lattice) {
     // reset also the rank and numbers -fields
     MPI_Comm_rank(lattice.mpi_comm_lat, &lattice.mynode.rank);
     MPI_Comm_size(lattice.mpi_comm_lat, &lattice.nodes.number);
+
+    setup_job_queue();
+}
+
+////////////////////////////////////////////////////////////////////////
+/// Collective MPI-IO of node blocks.
+/// The file contains the lattice sites in the standard hila file order
+/// (x runs fastest, last direction slowest).  Each rank reads or writes only
+/// its own node block, with the local data ordered as in Field::copy_local_data().
+
+// check the return value of MPI-IO call on all ranks, terminate if any failed
+static bool mpi_io_ok(int status, const char *call, const std::string &filename) {
+    int err = (status != MPI_SUCCESS);
+    if (err)
+        hila::out << "MPI-IO ERROR: " << call << " failed on file " << filename << " on rank "
+                  << hila::myrank() << '\n';
+
+    int anyerr;
+    MPI_Allreduce(&err, &anyerr, 1, MPI_INT, MPI_MAX, lattice.mpi_comm_lat);
+    return anyerr == 0;
 }
 
+bool hila::open_mpi_file(const std::string &filename, MPI_File &fh, bool write) {
+
+    if (hila::check_input)
+        return true;
+
+    int mode = write ? (MPI_MODE_WRONLY | MPI_MODE_CREATE) : MPI_MODE_RDONLY;
+
+    mpi_io_timer.start();
+    int status = MPI_File_open(lattice.mpi_comm_lat, filename.c_str(), mode, MPI_INFO_NULL, &fh);
+    mpi_io_timer.stop();
+
+    if (!mpi_io_ok(status, "MPI_File_open", filename)) {
+        hila::out0 << "ERROR in opening file " << filename << '\n';
+        hila::terminate(write ? 4 : 5);
+    }
+    return true;
+}
+
+bool hila::close_mpi_file(const std::string &filename, MPI_File &fh) {
+
+    if (hila::check_input)
+        return true;
+
+    mpi_io_timer.start();
+    int status = MPI_File_close(&fh);
+    mpi_io_timer.stop();
+
+    if (!mpi_io_ok(status, "MPI_File_close", filename)) {
+        hila::out0 << "ERROR in reading/writing file " << filename << '\n';
+        hila::terminate(3);
+    }
+    return true;
+}
+
+// Set the file view so that this rank sees only its own node block.
+// Returns the element type, which has to be freed by the caller
+static MPI_Datatype set_node_block_view(MPI_File fh, MPI_Offset offset, size_t element_size) {
+
+    assert(lattice.mynode.volume() <= (size_t)std::numeric_limits<int>::max() &&
+           "Too many sites on a node for MPI-IO");
+
+    MPI_Datatype elemtype, filetype;
+    MPI_Type_contiguous(element_size, MPI_BYTE, &elemtype);
+    MPI_Type_commit(&elemtype);
+
+    // MPI_ORDER_C: the last index runs fastest, thus directions in reverse order
+    int sizes[NDIM], subsizes[NDIM], starts[NDIM];
+    for (int i = 0; i < NDIM; i++) {
+        int d = NDIM - 1 - i;
+        sizes[i] = lattice.size(d);
+        subsizes[i] = lattice.mynode.size[d];
+        starts[i] = lattice.mynode.min[d];
+    }
+    MPI_Type_create_subarray(NDIM, sizes, subsizes, starts, MPI_ORDER_C, elemtype, &filetype);
+    MPI_Type_commit(&filetype);
+
+    MPI_File_set_view(fh, offset, elemtype, filetype, "native", MPI_INFO_NULL);
+    MPI_Type_free(&filetype);
+
+    return elemtype;
+}
+
+void hila::write_node_block(MPI_File fh, MPI_Offset offset, const void *buffer,
+                            size_t element_size) {
+
+    if (hila::check_input)
+        return;
+
+    mpi_io_timer.start();
+    MPI_Datatype elemtype = set_node_block_view(fh, offset, element_size);
+    int status = MPI_File_write_all(fh, buffer, lattice.mynode.volume(), elemtype,
+                                    MPI_STATUS_IGNORE);
+    MPI_Type_free(&elemtype);
+    mpi_io_timer.stop();
+
+    if (!mpi_io_ok(status, "MPI_File_write_all", "(collective write)"))
+        hila::terminate(3);
+}
+
+void hila::read_node_block(MPI_File fh, MPI_Offset offset, void *buffer, size_t element_size) {
+
+    if (hila::check_input)
+        return;
+
+    mpi_io_timer.start();
+    MPI_Datatype elemtype = set_node_block_view(fh, offset, element_size);
+    int status =
+        MPI_File_read_all(fh, buffer, lattice.mynode.volume(), elemtype, MPI_STATUS_IGNORE);
+    MPI_Type_free(&elemtype);
+    mpi_io_timer.stop();
+
+    if (!mpi_io_ok(status, "MPI_File_read_all", "(collective read)"))
+        hila::terminate(3);
+}
+
+
 #if 0
 
 // Switch comm frame global-sublat
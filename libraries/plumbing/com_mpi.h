@@ -5,6 +5,10 @@
 
 #include "plumbing/lattice.h"
 
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
 /// let us house the partitions-struct here
 namespace hila {
 class partitions_struct {
@@ -21,6 +25,17 @@ class partitions_struct {
     bool sync() {
         return _sync;
     }
+
+    /// Work queue for the partitions: returns the index of the next job, 0 ... n_jobs-1,
+    /// or -1 when all jobs have been taken.  A partition gets a new job whenever it
+    /// asks for one, so that jobs with different run times keep all partitions busy:
+    ///     int64_t job;
+    ///     while ((job = hila::partitions.next_job(n_jobs)) >= 0) {
+    ///         ... // e.g. measure configuration number job
+    ///     }
+    /// The job counter is global to the run (one queue).  Collective within the partition.
+    /// Without partitions the jobs are returned in order
+    int64_t next_job(int64_t n_jobs);
 };
 
 extern partitions_struct partitions;
@@ -41,7 +56,8 @@ extern hila::timer
         send_timer,
         cancel_send_timer,
         cancel_receive_timer,
-        partition_sync_timer;
+        partition_sync_timer,
+        mpi_io_timer;
 // clang-format on
 
 ///***********************************************************
@@ -51,6 +67,74 @@ extern hila::timer
 // The MPI tag generator
 int get_next_msg_tag();
 
+// Tag of the acknowledgement of a shared memory halo exchange with gather tag
+int get_shared_ack_tag(int tag);
+
+// Tags of persistent gathers: a block of 3*NDIRS tags for each gathered field, taken at
+// its first gather.  The blocks are handed out deterministically, so that they are the
+// same on all ranks.  -1 if none left
+int get_persistent_tag_base();
+void release_persistent_tag_base(int base);
+
+namespace hila {
+/// true while a reduced_precision_halo object exists
+extern bool reduced_precision_halo_on;
+
+/// Gathers of double precision fields are sent in single precision while an object of
+/// this class exists, e.g. in the inner solve of a mixed precision inverter:
+///     {
+///         hila::reduced_precision_halo single_halos;
+///         ...
+///     }
+/// Must be used in the same way on all ranks.  See also Field::set_reduced_precision_halo()
+class reduced_precision_halo {
+  private:
+    bool previous;
+
+  public:
+    reduced_precision_halo() : previous(reduced_precision_halo_on) {
+        reduced_precision_halo_on = true;
+    }
+    ~reduced_precision_halo() {
+        reduced_precision_halo_on = previous;
+    }
+};
+
+/// Let MPI progress the messages in flight, without waiting for any of them
+void progress_comms();
+
+/// Called by hilapp-generated code for site k of the interior loop while the gathers
+/// are in flight, polls every COMM_PROGRESS_INTERVAL sites on the main thread
+inline void progress_comms(int k) {
+#ifdef COMM_PROGRESS
+    static_assert((COMM_PROGRESS_INTERVAL & (COMM_PROGRESS_INTERVAL - 1)) == 0,
+                  "COMM_PROGRESS_INTERVAL must be a power of 2");
+#ifdef OPENMP
+    if ((k & (COMM_PROGRESS_INTERVAL - 1)) == 0 && omp_get_thread_num() == 0)
+#else
+    if ((k & (COMM_PROGRESS_INTERVAL - 1)) == 0)
+#endif
+        progress_comms();
+#endif
+}
+} // namespace hila
+
+#ifdef SHARED_MEMORY_HALO
+namespace hila {
+/// Set up the node-shared halo window on lattice.mpi_comm_lat.  Collective
+void setup_shared_halo();
+/// Start of the shared halo pool of a lattice rank, nullptr if rank is not on this host
+char *shared_halo_base(int rank);
+/// Allocate bytes from the pool of this rank, returns the offset or -1 if no room
+int64_t shared_halo_alloc(size_t bytes);
+void shared_halo_free(int64_t offset, size_t bytes);
+/// Memory barrier for the window: after writing before notifying, after notification
+/// before reading, after reading before acknowledging, and after the acknowledgement
+/// before writing again
+void shared_halo_sync();
+} // namespace hila
+#endif
+
 /// Obtain the MPI data type (MPI_XXX) for a particular type of native numbers.
 ///
 /// @brief Return MPI data type compatible with native number type
@@ -351,6 +435,24 @@ T reduce_node_product(T &var, bool allreduce = true) {
 void set_allreduce(bool on = true);
 bool get_allreduce();
 
+/// Fused reductions: between start_fused_reductions() and hila_reduce_sums() the
+/// blocking reductions of Reduction and ReductionVector variables are collected with
+/// fused_reduction_setup(), and done in one collective per number type and operation.
+/// The code generated by hilapp does this for the reductions of each site loop
+void start_fused_reductions();
+bool is_fused_reduction();
+void fused_reduction_setup(void *ptr, int count, MPI_Datatype dtype, MPI_Op op,
+                           bool allreduce);
+
+/// Collective MPI-IO of the node-local data, used in parallel field I/O.
+/// The file holds all lattice sites in the hila file order (x runs fastest),
+/// starting at byte offset "offset"; buffer holds the node-local sites in the order of
+/// Field::copy_local_data().  All ranks must call these.
+bool open_mpi_file(const std::string &filename, MPI_File &fh, bool write);
+bool close_mpi_file(const std::string &filename, MPI_File &fh);
+void write_node_block(MPI_File fh, MPI_Offset offset, const void *buffer, size_t element_size);
+void read_node_block(MPI_File fh, MPI_Offset offset, void *buffer, size_t element_size);
+
 
 } // namespace hila
 
@@ -369,7 +471,8 @@ void hila_reduce_sum_setup(T *value) {
     } else if (std::is_same<b_t, float>::value) {
         hila_reduce_float_setup((float *)value, sizeof(T) / sizeof(float));
     } else {
-        hila::reduce_node_sum(value, 1, hila::get_allreduce());
+        hila::fused_reduction_setup(value, sizeof(T) / sizeof(b_t), get_MPI_number_type<T>(),
+                                    MPI_SUM, hila::get_allreduce());
     }
 }
 
@@ -0,0 +1,54 @@
+#include "plumbing/defs.h"
+#include "plumbing/lattice.h"
+#include "plumbing/com_mpi.h"
+#include "plumbing/element_query.h"
+
+//////////////////////////////////////////////////////////////////
+/// Distributed element queries - see element_query.h
+//////////////////////////////////////////////////////////////////
+
+namespace hila {
+
+element_query::element_query(const std::vector<CoordinateVector> &coord_list) {
+
+    int nn = lattice.n_nodes();
+    receive_count.assign(nn, 0);
+    receive_displ.assign(nn, 0);
+    send_count.resize(nn);
+    send_displ.resize(nn);
+
+    // sort the coordinates by the owner rank, keeping the original order within each rank
+    std::vector<int> owner(coord_list.size());
+    for (size_t i = 0; i < coord_list.size(); i++) {
+        owner[i] = lattice.node_rank(coord_list[i]);
+        receive_count[owner[i]]++;
+    }
+    for (int r = 1; r < nn; r++)
+        receive_displ[r] = receive_displ[r - 1] + receive_count[r - 1];
+
+    // owner-side site indices of the coordinates, these are sent to the owners
+    order.resize(coord_list.size());
+    std::vector<unsigned> index(coord_list.size());
+    std::vector<int> pos(receive_displ);
+    for (size_t i = 0; i < coord_list.size(); i++) {
+        int p = pos[owner[i]]++;
+        order[p] = i;
+        index[p] = lattice.site_index(coord_list[i], owner[i]);
+    }
+
+    send_timer.start();
+    MPI_Alltoall(receive_count.data(), 1, MPI_INT, send_count.data(), 1, MPI_INT,
+                 lattice.mpi_comm_lat);
+
+    send_displ[0] = 0;
+    for (int r = 1; r < nn; r++)
+        send_displ[r] = send_displ[r - 1] + send_count[r - 1];
+    local_index.resize(send_displ[nn - 1] + send_count[nn - 1]);
+
+    MPI_Alltoallv(index.data(), receive_count.data(), receive_displ.data(), MPI_UNSIGNED,
+                  local_index.data(), send_count.data(), send_displ.data(), MPI_UNSIGNED,
+                  lattice.mpi_comm_lat);
+    send_timer.stop();
+}
+
+} // namespace hila
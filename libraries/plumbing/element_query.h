@@ -0,0 +1,106 @@
+#ifndef ELEMENT_QUERY_H_
+#define ELEMENT_QUERY_H_
+
+//////////////////////////////////////////////////////////////////////
+/// Distributed access to field elements at a list of coordinates.
+///
+/// Each rank gives its own list of coordinates, which can be different on every rank
+/// (or empty).  The constructor sorts the coordinates by the owner rank and sends the
+/// site indices to the owners once, so that the query can be reused for any field:
+///
+///     hila::element_query q(my_coordinates);   // collective
+///     std::vector<T> v = q.get(f);             // elements of f at my_coordinates
+///     q.set(g, v);                              // and set them to g
+///
+/// Each get() and set() is one MPI_Alltoallv: the elements go directly between the
+/// requesting and the owning ranks, nothing is routed through rank 0.
+/// Field::get_elements() uses this.
+
+#include "plumbing/defs.h"
+#include "plumbing/lattice.h"
+#include "plumbing/com_mpi.h"
+
+template <typename T>
+class Field;
+
+namespace hila {
+
+class element_query {
+  private:
+    // per rank counts and displacements of the elements sent in get(), in elements.
+    // "send" is the owner side, "receive" the requesting side
+    std::vector<int> send_count, send_displ, receive_count, receive_displ;
+
+    // site indices on this rank asked by the other ranks, in rank order
+    std::vector<unsigned> local_index;
+
+    // position in the coordinate list of each received element
+    std::vector<size_t> order;
+
+    // scale counts to bytes for MPI_BYTE transfers
+    static std::vector<int> bytes(const std::vector<int> &v, size_t size) {
+        std::vector<int> res(v.size());
+        for (size_t i = 0; i < v.size(); i++) {
+            assert(v[i] * size < (1ULL << 31) && "Too large MPI message in element_query");
+            res[i] = v[i] * size;
+        }
+        return res;
+    }
+
+  public:
+    /// Set up the query for coordinates coord_list.  Collective
+    element_query(const std::vector<CoordinateVector> &coord_list);
+
+    /// number of elements asked by this rank
+    size_t size() const {
+        return order.size();
+    }
+
+    /// Get the elements of f at the coordinates of this rank. Collective
+    template <typename T>
+    std::vector<T> get(const Field<T> &f) const {
+        std::vector<T> send_buffer(local_index.size()), receive_buffer(order.size());
+        f.check_alloc();
+        f.fs->payload.gather_elements(send_buffer.data(), local_index.data(),
+                                      local_index.size(), lattice);
+
+        auto sc = bytes(send_count, sizeof(T)), sd = bytes(send_displ, sizeof(T));
+        auto rc = bytes(receive_count, sizeof(T)), rd = bytes(receive_displ, sizeof(T));
+        send_timer.start();
+        MPI_Alltoallv(send_buffer.data(), sc.data(), sd.data(), MPI_BYTE, receive_buffer.data(),
+                      rc.data(), rd.data(), MPI_BYTE, lattice.mpi_comm_lat);
+        send_timer.stop();
+
+        std::vector<T> res(order.size());
+        for (size_t i = 0; i < order.size(); i++)
+            res[order[i]] = receive_buffer[i];
+        return res;
+    }
+
+    /// Set the elements of f at the coordinates of this rank.  If several ranks set
+    /// the same site, the value which is set is undefined.  Collective
+    template <typename T>
+    void set(Field<T> &f, const std::vector<T> &elements) const {
+        assert(elements.size() == order.size() && "vector size mismatch in element_query::set");
+        std::vector<T> send_buffer(order.size()), receive_buffer(local_index.size());
+        for (size_t i = 0; i < order.size(); i++)
+            send_buffer[i] = elements[order[i]];
+
+        // the reverse of get()
+        auto sc = bytes(receive_count, sizeof(T)), sd = bytes(receive_displ, sizeof(T));
+        auto rc = bytes(send_count, sizeof(T)), rd = bytes(send_displ, sizeof(T));
+        send_timer.start();
+        MPI_Alltoallv(send_buffer.data(), sc.data(), sd.data(), MPI_BYTE, receive_buffer.data(),
+                      rc.data(), rd.data(), MPI_BYTE, lattice.mpi_comm_lat);
+        send_timer.stop();
+
+        f.check_alloc();
+        f.fs->payload.place_elements(receive_buffer.data(), local_index.data(),
+                                     local_index.size(), lattice);
+        f.mark_changed(ALL);
+    }
+};
+
+} // namespace hila
+
+#endif
@@ -17,6 +17,8 @@
 #include "plumbing/backend_vector/vector_types.h"
 
 #include "plumbing/com_mpi.h"
+#include "plumbing/checksum.h"
+#include "plumbing/element_query.h"
 
 
 // This is a marker for hilapp -- will be removed by it
@@ -28,6 +30,21 @@ class Field;
 template <typename T>
 void ensure_field_operators_exist();
 
+// lazy Field arithmetic, see field_expr.h
+template <typename E>
+class FieldExpr;
+
+namespace hila {
+// batched gathers, see gather_batch.h
+class gather_batch;
+void complete_gather_batch(gather_batch *batch);
+
+template <typename T, typename E>
+void assign_field_expr(Field<T> &res, Parity par, const E &e);
+template <typename T>
+struct is_field_expr;
+} // namespace hila
+
 #include "plumbing/ensure_loop_functions.h"
 
 /**
@@ -82,6 +99,30 @@ class Field {
 
         MPI_Request receive_request[3][NDIRS];
         MPI_Request send_request[3][NDIRS];
+#ifdef PERSISTENT_GATHERS
+        // first tag of the persistent gather requests: -2 before the first gather,
+        // -1 if no tag block was free
+        int persistent_tag_base;
+#endif
+#ifdef SHARED_MEMORY_HALO
+        // send buffers in the node-shared window: offset in the pool, -1 if not allocated
+        int64_t shared_send_offset[NDIRS];
+        // notification messages: position of the neighbour's send buffer, sent / received
+        int64_t shared_send_position[3][NDIRS];
+        int64_t shared_receive_position[3][NDIRS];
+        // the receiver acknowledges when it has copied the data, with a tag of its own
+        MPI_Request shared_ack_request[3][NDIRS];
+        int shared_ack_tag[3][NDIRS];
+#endif
+        // batch where gathers of this field are going on, nullptr if none
+        hila::gather_batch *gather_batch;
+        // single precision halo exchange, see set_reduced_precision_halo():
+        // set for this field, directions where the halo is in single precision, and the
+        // single precision message buffers
+        bool reduced_halo;
+        dir_mask_t reduced_halo_dirs;
+        float *reduced_send_buffer[NDIRS];
+        float *reduced_receive_buffer[NDIRS];
 #ifndef VANILLA
         // vanilla needs no special receive buffers
         T *receive_buffer[NDIRS];
@@ -90,16 +131,56 @@ class Field {
 
         void initialize_communication() {
             for (int d = 0; d < NDIRS; d++) {
-                for (int p = 0; p < 3; p++)
+                for (int p = 0; p < 3; p++) {
                     gather_status_arr[p][d] = gather_status_t::NOT_DONE;
+                    receive_request[p][d] = MPI_REQUEST_NULL;
+                    send_request[p][d] = MPI_REQUEST_NULL;
+                }
                 send_buffer[d] = nullptr;
 #ifndef VANILLA
                 receive_buffer[d] = nullptr;
+#endif
+#ifdef SHARED_MEMORY_HALO
+                shared_send_offset[d] = -1;
+                for (int p = 0; p < 3; p++)
+                    shared_ack_request[p][d] = MPI_REQUEST_NULL;
 #endif
             }
+#ifdef PERSISTENT_GATHERS
+            persistent_tag_base = -2;
+#endif
+            gather_batch = nullptr;
+            reduced_halo = false;
+            reduced_halo_dirs = 0;
+            for (unsigned d = 0; d < NDIRS; d++)
+                reduced_send_buffer[d] = reduced_receive_buffer[d] = nullptr;
         }
 
         void free_communication() {
+#ifdef PERSISTENT_GATHERS
+            for (unsigned d = 0; d < NDIRS; d++) {
+                for (int p = 0; p < 3; p++) {
+                    if (receive_request[p][d] != MPI_REQUEST_NULL)
+                        MPI_Request_free(&receive_request[p][d]);
+                    if (send_request[p][d] != MPI_REQUEST_NULL)
+                        MPI_Request_free(&send_request[p][d]);
+                }
+            }
+            release_persistent_tag_base(persistent_tag_base);
+#endif
+#ifdef SHARED_MEMORY_HALO
+            for (unsigned d = 0; d < NDIRS; d++) {
+                if (shared_send_offset[d] >= 0)
+                    hila::shared_halo_free(shared_send_offset[d],
+                                           lattice.nn_comminfo[d].to_node.sites * sizeof(T));
+            }
+#endif
+            for (unsigned d = 0; d < NDIRS; d++) {
+                if (reduced_send_buffer[d] != nullptr)
+                    std::free(reduced_send_buffer[d]);
+                if (reduced_receive_buffer[d] != nullptr)
+                    std::free(reduced_receive_buffer[d]);
+            }
             for (int d = 0; d < NDIRS; d++) {
                 if (send_buffer[d] != nullptr)
                     payload.free_mpi_buffer(send_buffer[d]);
@@ -177,6 +258,40 @@ class Field {
         /// get the receive buffer pointer for the communication.
         T *get_receive_buffer(Direction d, Parity par,
                               const lattice_struct::comm_node_struct &from_node);
+
+        /// Post the receive / start the send of a gather, with the halo exchange method
+        /// used for this field and neighbour
+        void start_receive(Direction d, Parity par, int tag, bool reduced,
+                           const lattice_struct::comm_node_struct &from_node);
+        void start_send(Direction d, Parity par, int tag, bool reduced,
+                        const lattice_struct::comm_node_struct &to_node);
+
+#ifdef PERSISTENT_GATHERS
+        /// Start persistent gather receive / send, the request is created on first use
+        void start_persistent_receive(Direction d, int par_i, T *buffer, int n,
+                                      MPI_Datatype mpi_type, int rank);
+        void start_persistent_send(Direction d, int par_i, T *buffer, int n,
+                                   MPI_Datatype mpi_type, int rank);
+#endif
+
+#ifdef SHARED_MEMORY_HALO
+        /// Halo exchange with a rank on the same host through the node-shared window
+        void start_shared_receive(Direction d, Parity par, int tag,
+                                  const lattice_struct::comm_node_struct &from_node);
+        void start_shared_send(Direction d, Parity par, int tag,
+                               const lattice_struct::comm_node_struct &to_node);
+        void wait_shared_receive(Direction d, Parity par,
+                                 const lattice_struct::comm_node_struct &from_node);
+        void wait_shared_send(Direction d, Parity par);
+#endif
+
+        /// Single precision halo exchange
+        void start_reduced_receive(Direction d, Parity par, int tag,
+                                   const lattice_struct::comm_node_struct &from_node);
+        void start_reduced_send(Direction d, Parity par, int tag,
+                                const lattice_struct::comm_node_struct &to_node);
+        void wait_reduced_receive(Direction d, Parity par,
+                                  const lattice_struct::comm_node_struct &from_node);
     };
 
     // static_assert( std::is_pod<T>::value, "Field expects only pod-type elements
@@ -259,6 +374,22 @@ class Field {
         (*this)[ALL] = 0;
     }
 
+    /**
+     * @brief Construct a new Field from a Field expression,
+     * e.g. Field<double> f = hila::lazy(a) + hila::lazy(b) * c;
+     * @details The expression is computed in one site loop, see field_expr.h
+     *
+     * @tparam E expression type
+     * @param e
+     */
+    template <typename E,
+              std::enable_if_t<hila::is_assignable<T &, typename E::element_type>::value ||
+                                   std::is_convertible<typename E::element_type, T>::value,
+                               int> = 0>
+    Field(const FieldExpr<E> &e) : Field() {
+        hila::assign_field_expr(*this, ALL, e.self());
+    }
+
     /**
      * @brief Construct a new Field object by stealing content from previous field (rhs) which will
      * be set to null
@@ -469,6 +600,50 @@ class Field {
         set_gather_status(p, dir, gather_status_t::STARTED);
     }
 
+    /**
+     * @brief Send the halos of the Field in single precision
+     * @details For fields with double precision numbers only: the boundary elements
+     * are converted to float for the messages, halving the bytes sent.  The halo values
+     * are then accurate only to single precision.  Must be set in the same way on
+     * all ranks.  See also hila::reduced_precision_halo.  No effect on GPUs
+     * @param on
+     */
+    void set_reduced_precision_halo(bool on) {
+        check_alloc();
+        fs->reduced_halo = on;
+    }
+
+    /**
+     * @brief True if the gathers of the Field are now done in single precision
+     */
+    bool is_reduced_precision_halo() const {
+#if defined(CUDA) || defined(HIP)
+        return false;
+#else
+        if constexpr (std::is_same<hila::scalar_type<T>, double>::value &&
+                      sizeof(T) % sizeof(double) == 0)
+            return hila::reduced_precision_halo_on || (fs != nullptr && fs->reduced_halo);
+        else
+            return false;
+#endif
+    }
+
+    /**
+     * @brief Make the halo status in direction d agree with the precision of the gather
+     * @details The halo content or ongoing gathers of the other precision are not used:
+     * gathers going on are completed and the halo is marked not done
+     */
+    void check_halo_precision(Direction d, bool reduced) const {
+        if (((fs->reduced_halo_dirs & get_dir_mask(d)) != 0) != reduced) {
+            for (Parity par : {EVEN, ODD, ALL}) {
+                if (is_gather_started(d, par))
+                    wait_gather(d, par);
+                set_gather_status(par, d, gather_status_t::NOT_DONE);
+            }
+            fs->reduced_halo_dirs ^= get_dir_mask(d);
+        }
+    }
+
     /**
      * @brief Check if communication has started
      * @hilapponly
@@ -697,6 +872,27 @@ class Field {
         return *this;
     }
 
+    /**
+     * @brief Assignment from a Field expression, computed in one site loop
+     * \code{.cpp}
+     * Field<double> f, a, b, c;
+     * . . .
+     * f = hila::lazy(a) + hila::lazy(b) * c;   // onsites(ALL) f[X] = a[X] + b[X] * c[X];
+     * \endcode
+     *
+     * @tparam E expression type, see field_expr.h
+     * @param e expression
+     * @return Field<T>&
+     */
+    template <typename E,
+              std::enable_if_t<hila::is_assignable<T &, typename E::element_type>::value ||
+                                   std::is_convertible<typename E::element_type, T>::value,
+                               int> = 0>
+    Field<T> &operator=(const FieldExpr<E> &e) {
+        hila::assign_field_expr(*this, ALL, e.self());
+        return *this;
+    }
+
     /**
      * @brief Move Assignment
      *
@@ -992,8 +1188,9 @@ class Field {
      */
 
     /**
-     * @brief Create a periodically shifted copy of the field
-     * @details  this is currently OK only for short moves, very inefficient for longer moves
+     * @brief Create a periodically shifted copy of the field, r[X] = f[X + v]
+     * @details Moves longer than 1 use a general gather cached in lattice, which sends
+     * one message to each node involved regardless of the length of the move
      * @param v CoordinateVector to shift field with
      * @param r Field to store result in
      * @param par Parity
@@ -1002,8 +1199,7 @@ class Field {
     Field<T> &shift(const CoordinateVector &v, Field<T> &r, Parity par) const;
     /**
      * @brief Create a periodically shifted copy of the field
-     * @details this is currently OK only for short moves, very inefficient for longer moves.
-     * If Parity is not given to shift, then it is called with Parity ALL
+     * @details If Parity is not given to shift, then it is called with Parity ALL
      * @param v CoordinateVector to shift field with
      * @param r Field to store result in
      * @return Field<T>&
@@ -1013,14 +1209,34 @@ class Field {
     }
     /**
      * @brief Create a periodically shifted copy of the field
-     * @details This is currently OK only for short moves, very inefficient for longer moves
      * @param v CoordinateVector to shift field with
      * @param par Parity
      * @return Field<T>
      */
     Field<T> shift(const CoordinateVector &v, Parity par) const;
+
+    /**
+     * @brief Periodically shifted copies of the field for several offsets,
+     * r[k][X] = f[X + v[k]]
+     * @details The moves longer than 1 go in one communication round, with one message to /
+     * from each node involved for all of the offsets.  hilapp uses this for the
+     * f[X + offset] -references of a site loop, e.g. f[X + e_x + e_y] and f[X + 2*e_x]
+     * @param v CoordinateVectors to shift field with
+     * @param r Fields to store the results in, one for each offset
+     * @param par Parity
+     */
+    void shift(const std::vector<CoordinateVector> &v, const std::vector<Field<T> *> &r,
+               Parity par) const;
     /** @} */
 
+  private:
+    /// shift as a sequence of nearest neighbour moves
+    Field<T> &shift_by_steps(const CoordinateVector &v, Field<T> &r, Parity par) const;
+    /// does shift by v use a general gather
+    bool is_general_shift(const CoordinateVector &v) const;
+
+  public:
+
     // General getters and setters
 
     /// Set a single element. Assuming that each node calls this with the same value, it
@@ -1069,8 +1285,12 @@ class Field {
                       const std::vector<CoordinateVector> &coord_list);
     /**
      * @brief Retrieves list of elements to all nodes.
+     * @details The elements are sent directly from the owner ranks with one MPI_Alltoallv,
+     * see hila::element_query.  For repeated queries of the same sites keep an
+     * element_query object instead
      * @param coord_list vector of coordinates which will be fetched
-     * @param broadcast if true then elements retrieved to root node will be broadcast to all nodes
+     * @param broadcast if true then elements are retrieved to all nodes, otherwise only to
+     * the root node
      * @return std::vector<T> list of all elements
      */
     std::vector<T> get_elements(const std::vector<CoordinateVector> &coord_list,
@@ -1163,13 +1383,26 @@ class Field {
     Field<T> reflect(Direction dir) const;
     Field<T> reflect(const CoordinateVector &dirs) const;
 
-    // Writes the Field to disk
-    void write(std::ofstream &outputfile, bool binary = true, int precision = 8) const;
+    // Writes the Field to disk.  If checksum is given, the site checksum of the
+    // binary data is accumulated there (node-local part, call checksum->reduce() after)
+    void write(std::ofstream &outputfile, bool binary = true, int precision = 8,
+               hila::site_checksum *checksum = nullptr) const;
     void write(const std::string &filename, bool binary = true, int precision = 8) const;
 
-    void read(std::ifstream &inputfile);
+    void read(std::ifstream &inputfile, hila::site_checksum *checksum = nullptr);
     void read(const std::string &filename);
 
+    // Collective (MPI-IO) write and read at byte offset of a file opened with
+    // hila::open_mpi_file(). All ranks must call these
+    void write(MPI_File fh, MPI_Offset offset, hila::site_checksum *checksum = nullptr) const;
+    void read(MPI_File fh, MPI_Offset offset, hila::site_checksum *checksum = nullptr);
+
+    // Sharded write and read, one file per rank, see shard_io.h.  write_async() writes
+    // in a background thread; the file set is replaced in hila::wait_checkpoint()
+    void write_sharded(const std::string &filename) const;
+    void write_async(const std::string &filename) const;
+    void read_sharded(const std::string &filename);
+
     void write_subvolume(std::ofstream &outputfile, const CoordinateVector &cmin,
                          const CoordinateVector &cmax, int precision = 6) const;
     void write_subvolume(const std::string &filenname, const CoordinateVector &cmin,
@@ -1255,7 +1488,8 @@ class Field {
 // OK
 // There are several versions of the operators, depending if one of the arguments is
 // Field or scalar, and if the return type is the same as the Field argument.  This can
-// enable the compiler to avoid extra copies of the args
+// enable the compiler to avoid extra copies of the args.  Lazy Field expressions are not
+// scalars here, their operators are in field_expr.h
 
 ///////////////////////////////
 /// operator +  (Field + Field) -generic
@@ -1291,7 +1525,9 @@ auto operator+(const Field<A> &lhs, Field<B> rhs) {
 /// operator + (Field + scalar)
 
 template <typename A, typename B,
-          std::enable_if_t<!std::is_same<hila::type_plus<A, B>, A>::value, int> = 0>
+          std::enable_if_t<!hila::is_field_expr<B>::value &&
+                               !std::is_same<hila::type_plus<A, B>, A>::value,
+                           int> = 0>
 auto operator+(const Field<A> &lhs, const B &rhs) -> Field<hila::type_plus<A, B>> {
     Field<hila::type_plus<A, B>> tmp;
     tmp[ALL] = lhs[X] + rhs;
@@ -1299,7 +1535,9 @@ auto operator+(const Field<A> &lhs, const B &rhs) -> Field<hila::type_plus<A, B>
 }
 
 template <typename A, typename B,
-          std::enable_if_t<std::is_same<hila::type_plus<A, B>, A>::value, int> = 0>
+          std::enable_if_t<!hila::is_field_expr<B>::value &&
+                               std::is_same<hila::type_plus<A, B>, A>::value,
+                           int> = 0>
 Field<A> operator+(Field<A> lhs, const B &rhs) {
     lhs[ALL] += rhs;
     return lhs;
@@ -1310,13 +1548,17 @@ Field<A> operator+(Field<A> lhs, const B &rhs) {
 /// operator + (scalar + Field)
 
 template <typename A, typename B,
-          std::enable_if_t<!std::is_same<hila::type_plus<A, B>, B>::value, int> = 0>
+          std::enable_if_t<!hila::is_field_expr<A>::value &&
+                               !std::is_same<hila::type_plus<A, B>, B>::value,
+                           int> = 0>
 auto operator+(const A &lhs, const Field<B> &rhs) -> Field<hila::type_plus<A, B>> {
     return rhs + lhs;
 }
 
 template <typename A, typename B,
-          std::enable_if_t<std::is_same<hila::type_plus<A, B>, B>::value, int> = 0>
+          std::enable_if_t<!hila::is_field_expr<A>::value &&
+                               std::is_same<hila::type_plus<A, B>, B>::value,
+                           int> = 0>
 Field<B> operator+(const A &lhs, Field<B> rhs) {
     return rhs + lhs;
 }
@@ -1356,7 +1598,9 @@ auto operator-(const Field<A> &lhs, Field<B> rhs) {
 /// operator - (Field - scalar)
 
 template <typename A, typename B,
-          std::enable_if_t<!std::is_same<hila::type_minus<A, B>, A>::value, int> = 0>
+          std::enable_if_t<!hila::is_field_expr<B>::value &&
+                               !std::is_same<hila::type_minus<A, B>, A>::value,
+                           int> = 0>
 auto operator-(const Field<A> &lhs, const B &rhs) -> Field<hila::type_minus<A, B>> {
     Field<hila::type_minus<A, B>> tmp;
     tmp[ALL] = lhs[X] - rhs;
@@ -1364,7 +1608,9 @@ auto operator-(const Field<A> &lhs, const B &rhs) -> Field<hila::type_minus<A, B
 }
 
 template <typename A, typename B,
-          std::enable_if_t<std::is_same<hila::type_minus<A, B>, A>::value, int> = 0>
+          std::enable_if_t<!hila::is_field_expr<B>::value &&
+                               std::is_same<hila::type_minus<A, B>, A>::value,
+                           int> = 0>
 Field<A> operator-(Field<A> lhs, const B &rhs) {
     lhs[ALL] -= rhs;
     return lhs;
@@ -1374,7 +1620,9 @@ Field<A> operator-(Field<A> lhs, const B &rhs) {
 /// operator - (scalar - Field)
 
 template <typename A, typename B,
-          std::enable_if_t<!std::is_same<hila::type_minus<A, B>, B>::value, int> = 0>
+          std::enable_if_t<!hila::is_field_expr<A>::value &&
+                               !std::is_same<hila::type_minus<A, B>, B>::value,
+                           int> = 0>
 auto operator-(const A &lhs, const Field<B> &rhs) -> Field<hila::type_minus<A, B>> {
     Field<hila::type_minus<A, B>> tmp;
     tmp[ALL] = lhs - rhs[X];
@@ -1382,7 +1630,9 @@ auto operator-(const A &lhs, const Field<B> &rhs) -> Field<hila::type_minus<A, B
 }
 
 template <typename A, typename B,
-          std::enable_if_t<std::is_same<hila::type_minus<A, B>, B>::value, int> = 0>
+          std::enable_if_t<!hila::is_field_expr<A>::value &&
+                               std::is_same<hila::type_minus<A, B>, B>::value,
+                           int> = 0>
 Field<B> operator-(const A &lhs, Field<B> rhs) {
     rhs[ALL] = lhs - rhs[X];
     return rhs;
@@ -1423,7 +1673,9 @@ Field<B> operator*(const Field<A> &lhs, Field<B> rhs) {
 /// operator * (scalar * field)
 
 template <typename A, typename B,
-          std::enable_if_t<!std::is_same<hila::type_mul<A, B>, B>::value, int> = 0>
+          std::enable_if_t<!hila::is_field_expr<A>::value &&
+                               !std::is_same<hila::type_mul<A, B>, B>::value,
+                           int> = 0>
 auto operator*(const A &lhs, const Field<B> &rhs) -> Field<hila::type_mul<A, B>> {
     Field<hila::type_mul<A, B>> tmp;
     tmp[ALL] = lhs * rhs[X];
@@ -1431,7 +1683,9 @@ auto operator*(const A &lhs, const Field<B> &rhs) -> Field<hila::type_mul<A, B>>
 }
 
 template <typename A, typename B,
-          std::enable_if_t<std::is_same<hila::type_mul<A, B>, B>::value, int> = 0>
+          std::enable_if_t<!hila::is_field_expr<A>::value &&
+                               std::is_same<hila::type_mul<A, B>, B>::value,
+                           int> = 0>
 Field<B> operator*(const A &lhs, Field<B> rhs) {
     rhs[ALL] = lhs * rhs[X];
     return rhs;
@@ -1441,7 +1695,9 @@ Field<B> operator*(const A &lhs, Field<B> rhs) {
 /// operator * (field * scalar)
 
 template <typename A, typename B,
-          std::enable_if_t<!std::is_same<hila::type_mul<A, B>, A>::value, int> = 0>
+          std::enable_if_t<!hila::is_field_expr<B>::value &&
+                               !std::is_same<hila::type_mul<A, B>, A>::value,
+                           int> = 0>
 auto operator*(const Field<A> &lhs, const B &rhs) -> Field<hila::type_mul<A, B>> {
     Field<hila::type_mul<A, B>> tmp;
     tmp[ALL] = lhs[X] * rhs;
@@ -1449,7 +1705,9 @@ auto operator*(const Field<A> &lhs, const B &rhs) -> Field<hila::type_mul<A, B>>
 }
 
 template <typename A, typename B,
-          std::enable_if_t<std::is_same<hila::type_mul<A, B>, A>::value, int> = 0>
+          std::enable_if_t<!hila::is_field_expr<B>::value &&
+                               std::is_same<hila::type_mul<A, B>, A>::value,
+                           int> = 0>
 Field<A> operator*(Field<A> lhs, const B &rhs) {
     lhs[ALL] = lhs[X] * rhs;
     return lhs;
@@ -1489,7 +1747,9 @@ Field<B> operator/(const Field<A> &l, Field<B> r) {
 //////////////////////////////////
 /// operator /  (scalar/Field)
 template <typename A, typename B,
-          std::enable_if_t<!std::is_same<hila::type_div<A, B>, B>::value, int> = 0>
+          std::enable_if_t<!hila::is_field_expr<A>::value &&
+                               !std::is_same<hila::type_div<A, B>, B>::value,
+                           int> = 0>
 auto operator/(const A &lhs, const Field<B> &rhs) -> Field<hila::type_div<A, B>> {
     Field<hila::type_div<A, B>> tmp;
     tmp[ALL] = lhs / rhs[X];
@@ -1497,7 +1757,9 @@ auto operator/(const A &lhs, const Field<B> &rhs) -> Field<hila::type_div<A, B>>
 }
 
 template <typename A, typename B,
-          std::enable_if_t<std::is_same<hila::type_div<A, B>, B>::value, int> = 0>
+          std::enable_if_t<!hila::is_field_expr<A>::value &&
+                               std::is_same<hila::type_div<A, B>, B>::value,
+                           int> = 0>
 Field<B> operator/(const A &lhs, Field<B> rhs) {
     rhs[ALL] = lhs / rhs[X];
     return rhs;
@@ -1506,7 +1768,9 @@ Field<B> operator/(const A &lhs, Field<B> rhs) {
 //////////////////////////////////
 /// operator /  (Field/scalar)
 template <typename A, typename B,
-          std::enable_if_t<!std::is_same<hila::type_div<A, B>, A>::value, int> = 0>
+          std::enable_if_t<!hila::is_field_expr<B>::value &&
+                               !std::is_same<hila::type_div<A, B>, A>::value,
+                           int> = 0>
 auto operator/(const Field<A> &lhs, const B &rhs) -> Field<hila::type_div<A, B>> {
     Field<hila::type_div<A, B>> tmp;
     tmp[ALL] = lhs[X] / rhs;
@@ -1514,12 +1778,18 @@ auto operator/(const Field<A> &lhs, const B &rhs) -> Field<hila::type_div<A, B>>
 }
 
 template <typename A, typename B,
-          std::enable_if_t<std::is_same<hila::type_div<A, B>, A>::value, int> = 0>
+          std::enable_if_t<!hila::is_field_expr<B>::value &&
+                               std::is_same<hila::type_div<A, B>, A>::value,
+                           int> = 0>
 auto operator/(Field<A> lhs, const B &rhs) {
     lhs[ALL] = lhs[X] / rhs;
     return lhs;
 }
 
+///////////////////////////////
+// Opt-in lazy Field expressions, hila::lazy(a) + b * c etc., see field_expr.h
+#include "plumbing/field_expr.h"
+
 /**
  * @brief std:swap() for Fields
  *
@@ -1615,7 +1885,7 @@ Field<R> abs(const Field<T> &arg) {
     return res;
 }
 
-template <typename T, typename P, typename R = decltype(pow(std::declval<T>()), std::declval<P>())>
+template <typename T, typename P, typename R = decltype(pow(std::declval<T>(), std::declval<P>()))>
 Field<R> pow(const Field<T> &arg, const P p) {
     Field<R> res;
     onsites(ALL) {
@@ -1676,7 +1946,6 @@ Field<T> Field<T>::shift(const CoordinateVector &v, const Parity par) const {
     return res;
 }
 
-
 ///  drop_comms():  if field is changed or deleted,
 ///  cancel ongoing communications.  This should happen very seldom,
 ///  only if there are "by-hand" start_gather operations and these are not needed
@@ -1684,6 +1953,10 @@ template <typename T>
 void Field<T>::drop_comms(Direction d, Parity p) const {
 
     if (is_comm_initialized()) {
+        // batched gathers are not cancelled but completed
+        if (fs->gather_batch != nullptr)
+            hila::complete_gather_batch(fs->gather_batch);
+
         if (is_gather_started(d, ALL))
             cancel_comm(d, ALL);
         if (p != ALL) {
@@ -1698,18 +1971,31 @@ void Field<T>::drop_comms(Direction d, Parity p) const {
     }
 }
 
-/// cancel ongoing send and receive
+/// Stop an ongoing gather.  The send and receive are completed, not cancelled: a send
+/// which is already matched cannot be cancelled, and its message would be received by
+/// a later gather with the same tag (persistent gathers reuse their tags).  All ranks
+/// drop the same gathers, thus the matching messages are always posted.
+/// With SHARED_MEMORY_HALO and a neighbour on the same host this is a blocking
+/// wait_gather(): the neighbour is reading our window or waits for our acknowledgement.
 
 template <typename T>
 void Field<T>::cancel_comm(Direction d, Parity p) const {
+#ifdef SHARED_MEMORY_HALO
+    // the neighbour reads our window and acknowledges, complete the exchange instead
+    if (hila::shared_halo_base(lattice.nn_comminfo[d].from_node.rank) != nullptr ||
+        hila::shared_halo_base(lattice.nn_comminfo[d].to_node.rank) != nullptr) {
+        wait_gather(d, p);
+        return;
+    }
+#endif
     if (lattice.nn_comminfo[d].from_node.rank != hila::myrank()) {
         cancel_receive_timer.start();
-        MPI_Cancel(&fs->receive_request[(int)p - 1][d]);
+        MPI_Wait(&fs->receive_request[(int)p - 1][d], MPI_STATUS_IGNORE);
         cancel_receive_timer.stop();
     }
     if (lattice.nn_comminfo[d].to_node.rank != hila::myrank()) {
         cancel_send_timer.start();
-        MPI_Cancel(&fs->send_request[(int)p - 1][d]);
+        MPI_Wait(&fs->send_request[(int)p - 1][d], MPI_STATUS_IGNORE);
         cancel_send_timer.stop();
     }
 }
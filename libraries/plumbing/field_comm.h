@@ -155,11 +155,186 @@ T *Field<T>::field_struct::get_receive_buffer(Direction d, Parity par,
 } // end of get_receive_buffer
 
 
-#define NAIVE_SHIFT
-#if defined(NAIVE_SHIFT)
+#ifdef PERSISTENT_GATHERS
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Persistent gather requests.  Partner ranks, sizes and buffers are fixed for each
+/// field, direction and parity, thus the request is set up once and restarted.
+/// The tag is unique to the field (see get_persistent_tag_base()), direction and parity
 
 template <typename T>
-Field<T> &Field<T>::shift(const CoordinateVector &v, Field<T> &res, const Parity par) const {
+void Field<T>::field_struct::start_persistent_receive(Direction d, int par_i, T *buffer, int n,
+                                                      MPI_Datatype mpi_type, int rank) {
+    MPI_Request &req = receive_request[par_i][d];
+    if (req == MPI_REQUEST_NULL)
+        MPI_Recv_init(buffer, n, mpi_type, rank, persistent_tag_base + par_i * NDIRS + d,
+                      lattice.mpi_comm_lat, &req);
+    MPI_Start(&req);
+}
+
+template <typename T>
+void Field<T>::field_struct::start_persistent_send(Direction d, int par_i, T *buffer, int n,
+                                                   MPI_Datatype mpi_type, int rank) {
+    MPI_Request &req = send_request[par_i][d];
+    if (req == MPI_REQUEST_NULL)
+        MPI_Send_init(buffer, n, mpi_type, rank, persistent_tag_base + par_i * NDIRS + d,
+                      lattice.mpi_comm_lat, &req);
+    MPI_Start(&req);
+}
+
+#endif
+
+#ifdef SHARED_MEMORY_HALO
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Halo exchange through the node-shared window (see com_mpi.cpp).  The sender packs
+/// the boundary sites to its send buffer in the window and sends the position of the
+/// buffer in a short message.  The receiver copies the data directly from the window
+/// and acknowledges, after which the sender may reuse the buffer.
+/// The notification uses the tag of the gather, the acknowledgement the matching tag
+/// from get_shared_ack_tag().  Both sides call hila::shared_halo_sync() around the
+/// messages, so that the reads of the receiver are complete before the sender writes
+/// to the buffer again.
+
+template <typename T>
+void Field<T>::field_struct::start_shared_receive(
+    Direction d, Parity par, int tag, const lattice_struct::comm_node_struct &from_node) {
+    int par_i = static_cast<int>(par) - 1;
+    shared_ack_tag[par_i][d] = get_shared_ack_tag(tag);
+    MPI_Irecv(&shared_receive_position[par_i][d], 1, MPI_INT64_T, from_node.rank, tag,
+              lattice.mpi_comm_lat, &receive_request[par_i][d]);
+}
+
+template <typename T>
+void Field<T>::field_struct::start_shared_send(Direction d, Parity par, int tag,
+                                               const lattice_struct::comm_node_struct &to_node) {
+    int par_i = static_cast<int>(par) - 1;
+
+    if (shared_send_offset[d] < 0) {
+        shared_send_offset[d] = hila::shared_halo_alloc(to_node.sites * sizeof(T));
+        if (shared_send_offset[d] < 0) {
+            hila::out << "Shared memory halo pool exhausted, increase SHARED_HALO_POOL_MB\n";
+            hila::terminate(1);
+        }
+    }
+
+    char *base = hila::shared_halo_base(hila::myrank());
+    T *buffer = (T *)(base + shared_send_offset[d]) + to_node.offset(par);
+    gather_comm_elements(d, par, buffer, to_node);
+    hila::shared_halo_sync();
+
+    // post the acknowledgement receive first, so that the receiver does not wait for it
+    MPI_Irecv(nullptr, 0, MPI_BYTE, to_node.rank, get_shared_ack_tag(tag),
+              lattice.mpi_comm_lat, &shared_ack_request[par_i][d]);
+
+    shared_send_position[par_i][d] = (char *)buffer - base;
+    MPI_Isend(&shared_send_position[par_i][d], 1, MPI_INT64_T, to_node.rank, tag,
+              lattice.mpi_comm_lat, &send_request[par_i][d]);
+}
+
+template <typename T>
+void Field<T>::field_struct::wait_shared_receive(
+    Direction d, Parity par, const lattice_struct::comm_node_struct &from_node) {
+    int par_i = static_cast<int>(par) - 1;
+
+    MPI_Wait(&receive_request[par_i][d], MPI_STATUS_IGNORE);
+    hila::shared_halo_sync();
+
+    T *receive_buffer = get_receive_buffer(d, par, from_node);
+    std::memcpy(receive_buffer,
+                hila::shared_halo_base(from_node.rank) + shared_receive_position[par_i][d],
+                from_node.n_sites(par) * sizeof(T));
+    hila::shared_halo_sync();
+
+    // the matching receive is already posted, this returns at once
+    MPI_Send(nullptr, 0, MPI_BYTE, from_node.rank, shared_ack_tag[par_i][d], lattice.mpi_comm_lat);
+}
+
+template <typename T>
+void Field<T>::field_struct::wait_shared_send(Direction d, Parity par) {
+    int par_i = static_cast<int>(par) - 1;
+    MPI_Wait(&send_request[par_i][d], MPI_STATUS_IGNORE);
+    MPI_Wait(&shared_ack_request[par_i][d], MPI_STATUS_IGNORE);
+    // the receiver has copied the data, order its reads before our next writes
+    hila::shared_halo_sync();
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Single precision halo exchange of double precision fields: the boundary elements are
+/// converted to float for the messages, and back to double in wait_gather().
+/// Persistent requests of the full precision gathers are released, because the
+/// buffers differ
+
+template <typename T>
+void Field<T>::field_struct::start_reduced_receive(
+    Direction d, Parity par, int tag, const lattice_struct::comm_node_struct &from_node) {
+    constexpr size_t n_scalars = sizeof(T) / sizeof(double);
+    int par_i = static_cast<int>(par) - 1;
+
+    if (reduced_receive_buffer[d] == nullptr)
+        reduced_receive_buffer[d] =
+            (float *)memalloc(from_node.sites * n_scalars * sizeof(float));
+
+    MPI_Request &req = receive_request[par_i][d];
+    if (req != MPI_REQUEST_NULL)
+        MPI_Request_free(&req);
+
+    size_t start = (par == ODD) ? from_node.evensites : 0;
+    MPI_Irecv(reduced_receive_buffer[d] + start * n_scalars,
+              (int)(from_node.n_sites(par) * n_scalars), MPI_FLOAT, from_node.rank, tag,
+              lattice.mpi_comm_lat, &req);
+}
+
+template <typename T>
+void Field<T>::field_struct::start_reduced_send(Direction d, Parity par, int tag,
+                                                const lattice_struct::comm_node_struct &to_node) {
+    constexpr size_t n_scalars = sizeof(T) / sizeof(double);
+    int par_i = static_cast<int>(par) - 1;
+
+    if (send_buffer[d] == nullptr)
+        send_buffer[d] = payload.allocate_mpi_buffer(to_node.sites);
+    if (reduced_send_buffer[d] == nullptr)
+        reduced_send_buffer[d] = (float *)memalloc(to_node.sites * n_scalars * sizeof(float));
+
+    size_t start = (par == ODD) ? to_node.evensites : 0;
+    T *buffer = send_buffer[d] + start;
+    gather_comm_elements(d, par, buffer, to_node);
+
+    const double *from = reinterpret_cast<const double *>(buffer);
+    float *to = reduced_send_buffer[d] + start * n_scalars;
+    size_t n = to_node.n_sites(par) * n_scalars;
+    for (size_t i = 0; i < n; i++)
+        to[i] = from[i];
+
+    MPI_Request &req = send_request[par_i][d];
+    if (req != MPI_REQUEST_NULL)
+        MPI_Request_free(&req);
+    MPI_Isend(to, (int)n, MPI_FLOAT, to_node.rank, tag, lattice.mpi_comm_lat, &req);
+}
+
+template <typename T>
+void Field<T>::field_struct::wait_reduced_receive(
+    Direction d, Parity par, const lattice_struct::comm_node_struct &from_node) {
+    constexpr size_t n_scalars = sizeof(T) / sizeof(double);
+    int par_i = static_cast<int>(par) - 1;
+
+    MPI_Wait(&receive_request[par_i][d], MPI_STATUS_IGNORE);
+
+    size_t start = (par == ODD) ? from_node.evensites : 0;
+    const float *from = reduced_receive_buffer[d] + start * n_scalars;
+    double *to = reinterpret_cast<double *>(get_receive_buffer(d, par, from_node));
+    size_t n = from_node.n_sites(par) * n_scalars;
+    for (size_t i = 0; i < n; i++)
+        to[i] = from[i];
+}
+
+/// Shift by unit steps, each step a nearest neighbour gather.  Used for moves of
+/// length 1, which may find the gather already done, and for non-periodic boundaries
+template <typename T>
+Field<T> &Field<T>::shift_by_steps(const CoordinateVector &v, Field<T> &res,
+                                   const Parity par) const {
 
     // use this to store remaining moves
     CoordinateVector rem = v;
@@ -253,7 +428,331 @@ Field<T> &Field<T>::shift(const CoordinateVector &v, Field<T> &res, const Parity
     return res;
 }
 
-#endif // NAIVE_SHIFT
+/// Moves longer than 1 in periodic directions use the general gathers.
+/// Define NAIVE_SHIFT to always use unit steps
+template <typename T>
+bool Field<T>::is_general_shift(const CoordinateVector &v) const {
+
+    int len = 0;
+    bool periodic = true;
+    foralldir(d) {
+        len += abs(v[d]);
+        if (v[d] != 0 && get_boundary_condition(d) != hila::bc::PERIODIC)
+            periodic = false;
+    }
+
+#if defined(NAIVE_SHIFT)
+    periodic = false;
+#endif
+
+    return len > 1 && periodic;
+}
+
+/// Shift with the cached general gather of lattice: one message to / from each
+/// node involved, independent of the length of the move.
+template <typename T>
+Field<T> &Field<T>::shift(const CoordinateVector &v, Field<T> &res, const Parity par) const {
+
+    if (!is_general_shift(v))
+        return shift_by_steps(v, res, par);
+
+    assert(&res != this && "shift: result must be a different field");
+    check_alloc();
+    res.check_alloc();
+
+    // tags must be in sync on all ranks
+    int tag = get_next_msg_tag();
+
+    const lattice_struct::gen_comminfo_struct &ci = lattice.get_general_gather(v);
+    int par_i = static_cast<int>(par) - 1;
+
+    // post receives, one message from each node
+    std::vector<T> receive_buffer(ci.remote_sites[par_i].size());
+    std::vector<MPI_Request> receive_req(ci.from_node.size());
+    size_t offset = 0;
+    for (size_t n = 0; n < ci.from_node.size(); n++) {
+        size_t size = ci.from_node[n].n_sites(par) * sizeof(T);
+        assert(size < (1ULL << 31) && "Too large MPI message in shift");
+
+        post_receive_timer.start();
+        MPI_Irecv((char *)(receive_buffer.data() + offset), (int)size, MPI_BYTE,
+                  ci.from_node[n].rank, tag, lattice.mpi_comm_lat, &receive_req[n]);
+        post_receive_timer.stop();
+
+        offset += ci.from_node[n].n_sites(par);
+    }
+
+    // send, target sites of parity par
+    std::vector<std::vector<T>> send_buffer(ci.to_node.size());
+    std::vector<MPI_Request> send_req(ci.to_node.size());
+    for (size_t n = 0; n < ci.to_node.size(); n++) {
+        int sites;
+        const unsigned *sitelist = ci.to_node[n].get_sitelist(par, sites);
+        send_buffer[n].resize(sites);
+        fs->payload.gather_elements(send_buffer[n].data(), sitelist, sites, lattice);
+
+        start_send_timer.start();
+        MPI_Isend((char *)send_buffer[n].data(), (int)(sites * sizeof(T)), MPI_BYTE,
+                  ci.to_node[n].rank, tag, lattice.mpi_comm_lat, &send_req[n]);
+        start_send_timer.stop();
+    }
+
+    // node-local part while the messages are on their way
+    const std::vector<unsigned> &local_sites = ci.local_sites[par_i];
+    if (local_sites.size() > 0) {
+        std::vector<T> local_buffer(local_sites.size());
+        fs->payload.gather_elements(local_buffer.data(), ci.local_source[par_i].data(),
+                                    local_sites.size(), lattice);
+        res.fs->payload.place_elements(local_buffer.data(), local_sites.data(),
+                                       local_sites.size(), lattice);
+    }
+
+    if (receive_req.size() > 0) {
+        wait_receive_timer.start();
+        MPI_Waitall(receive_req.size(), receive_req.data(), MPI_STATUSES_IGNORE);
+        wait_receive_timer.stop();
+
+        res.fs->payload.place_elements(receive_buffer.data(), ci.remote_sites[par_i].data(),
+                                       receive_buffer.size(), lattice);
+    }
+
+    if (send_req.size() > 0) {
+        wait_send_timer.start();
+        MPI_Waitall(send_req.size(), send_req.data(), MPI_STATUSES_IGNORE);
+        wait_send_timer.stop();
+    }
+
+    res.mark_changed(par);
+    return res;
+}
+
+/// Shift with several offsets.  The messages of all offsets to / from a node are
+/// combined, in the order of the offsets.  The general gathers are taken from the lattice
+/// cache GEN_GATHER_CACHE_SIZE at a time, so that the references to them stay valid
+template <typename T>
+void Field<T>::shift(const std::vector<CoordinateVector> &v, const std::vector<Field<T> *> &res,
+                     const Parity par) const {
+
+    assert(v.size() == res.size() && "shift: one result field is needed for each offset");
+
+    // short moves by steps, the rest below
+    std::vector<size_t> gen;
+    for (size_t k = 0; k < v.size(); k++) {
+        if (is_general_shift(v[k]))
+            gen.push_back(k);
+        else
+            shift_by_steps(v[k], *res[k], par);
+    }
+
+    int par_i = static_cast<int>(par) - 1;
+
+    for (size_t first = 0; first < gen.size(); first += GEN_GATHER_CACHE_SIZE) {
+        size_t n_offsets = std::min(gen.size() - first, (size_t)GEN_GATHER_CACHE_SIZE);
+
+        check_alloc();
+        std::vector<Field<T> *> r(n_offsets);
+        std::vector<const lattice_struct::gen_comminfo_struct *> ci(n_offsets);
+        for (size_t k = 0; k < n_offsets; k++) {
+            r[k] = res[gen[first + k]];
+            assert(r[k] != this && "shift: result must be a different field");
+            r[k]->check_alloc();
+            ci[k] = &lattice.get_general_gather(v[gen[first + k]]);
+        }
+
+        // tags must be in sync on all ranks
+        int tag = get_next_msg_tag();
+
+        // message sizes, in elements
+        std::map<int, size_t> receive_size, send_size;
+        for (size_t k = 0; k < n_offsets; k++) {
+            for (auto &from : ci[k]->from_node)
+                receive_size[from.rank] += from.n_sites(par);
+            for (auto &to : ci[k]->to_node)
+                send_size[to.rank] += to.n_sites(par);
+        }
+
+        // post receives, one message from each node
+        std::map<int, std::vector<T>> receive_buffer;
+        std::vector<MPI_Request> receive_req(receive_size.size());
+        size_t n = 0;
+        for (auto &rs : receive_size) {
+            std::vector<T> &buf = receive_buffer[rs.first];
+            buf.resize(rs.second);
+            size_t size = rs.second * sizeof(T);
+            assert(size < (1ULL << 31) && "Too large MPI message in shift");
+
+            post_receive_timer.start();
+            MPI_Irecv((char *)buf.data(), (int)size, MPI_BYTE, rs.first, tag,
+                      lattice.mpi_comm_lat, &receive_req[n++]);
+            post_receive_timer.stop();
+        }
+
+        // pack and send, one message to each node
+        std::map<int, std::vector<T>> send_buffer;
+        for (auto &ss : send_size)
+            send_buffer[ss.first].resize(ss.second);
+
+        std::map<int, size_t> position;
+        for (size_t k = 0; k < n_offsets; k++) {
+            for (auto &to : ci[k]->to_node) {
+                int sites;
+                const unsigned *sitelist = to.get_sitelist(par, sites);
+                fs->payload.gather_elements(send_buffer[to.rank].data() + position[to.rank],
+                                            sitelist, sites, lattice);
+                position[to.rank] += sites;
+            }
+        }
+
+        std::vector<MPI_Request> send_req(send_size.size());
+        n = 0;
+        for (auto &sb : send_buffer) {
+            size_t size = sb.second.size() * sizeof(T);
+            assert(size < (1ULL << 31) && "Too large MPI message in shift");
+
+            start_send_timer.start();
+            MPI_Isend((char *)sb.second.data(), (int)size, MPI_BYTE, sb.first, tag,
+                      lattice.mpi_comm_lat, &send_req[n++]);
+            start_send_timer.stop();
+        }
+
+        // node-local parts while the messages are on their way
+        for (size_t k = 0; k < n_offsets; k++) {
+            const std::vector<unsigned> &local_sites = ci[k]->local_sites[par_i];
+            if (local_sites.size() > 0) {
+                std::vector<T> local_buffer(local_sites.size());
+                fs->payload.gather_elements(local_buffer.data(),
+                                            ci[k]->local_source[par_i].data(),
+                                            local_sites.size(), lattice);
+                r[k]->fs->payload.place_elements(local_buffer.data(), local_sites.data(),
+                                                 local_sites.size(), lattice);
+            }
+        }
+
+        if (receive_req.size() > 0) {
+            wait_receive_timer.start();
+            MPI_Waitall(receive_req.size(), receive_req.data(), MPI_STATUSES_IGNORE);
+            wait_receive_timer.stop();
+
+            // split the messages to the offsets
+            position.clear();
+            for (size_t k = 0; k < n_offsets; k++) {
+                std::vector<T> buf(ci[k]->remote_sites[par_i].size());
+                size_t offset = 0;
+                for (auto &from : ci[k]->from_node) {
+                    size_t sites = from.n_sites(par);
+                    const T *msg = receive_buffer[from.rank].data() + position[from.rank];
+                    std::copy(msg, msg + sites, buf.data() + offset);
+                    position[from.rank] += sites;
+                    offset += sites;
+                }
+                r[k]->fs->payload.place_elements(buf.data(), ci[k]->remote_sites[par_i].data(),
+                                                 buf.size(), lattice);
+            }
+        }
+
+        if (send_req.size() > 0) {
+            wait_send_timer.start();
+            MPI_Waitall(send_req.size(), send_req.data(), MPI_STATUSES_IGNORE);
+            wait_send_timer.stop();
+        }
+
+        for (size_t k = 0; k < n_offsets; k++)
+            r[k]->mark_changed(par);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+/// Post the receive of a gather from from_node.  The halo exchange goes in single
+/// precision, through the node-shared window, with a persistent request or with
+/// MPI_Irecv, in this order of preference
+
+template <typename T>
+void Field<T>::field_struct::start_receive(Direction d, Parity par, int tag, bool reduced,
+                                           const lattice_struct::comm_node_struct &from_node) {
+    if (reduced) {
+        start_reduced_receive(d, par, tag, from_node);
+        return;
+    }
+#ifdef SHARED_MEMORY_HALO
+    if (hila::shared_halo_base(from_node.rank) != nullptr) {
+        start_shared_receive(d, par, tag, from_node);
+        return;
+    }
+#endif
+
+    // buffer can be separate or in Field buffer
+    T *buffer = get_receive_buffer(d, par, from_node);
+
+    size_t size_type;
+    MPI_Datatype mpi_type = get_MPI_number_type<T>(size_type);
+    size_t n = from_node.n_sites(par) * sizeof(T) / size_type;
+
+    if (n >= (1ULL << 31)) {
+        hila::out << "Too large MPI message!  Size " << n << '\n';
+        hila::terminate(1);
+    }
+
+    int par_i = static_cast<int>(par) - 1; // index to dim-3 arrays
+
+#ifdef PERSISTENT_GATHERS
+    if (persistent_tag_base >= 0) {
+        start_persistent_receive(d, par_i, buffer, (int)n, mpi_type, from_node.rank);
+        return;
+    }
+#endif
+    // c++ version does not return errors
+    MPI_Irecv(buffer, (int)n, mpi_type, from_node.rank, tag, lattice.mpi_comm_lat,
+              &receive_request[par_i][d]);
+}
+
+/// Pack the boundary elements for to_node and start the send, the counterpart of
+/// start_receive()
+
+template <typename T>
+void Field<T>::field_struct::start_send(Direction d, Parity par, int tag, bool reduced,
+                                        const lattice_struct::comm_node_struct &to_node) {
+    if (reduced) {
+        start_send_timer.start();
+        start_reduced_send(d, par, tag, to_node);
+        start_send_timer.stop();
+        return;
+    }
+#ifdef SHARED_MEMORY_HALO
+    if (hila::shared_halo_base(to_node.rank) != nullptr) {
+        start_send_timer.start();
+        start_shared_send(d, par, tag, to_node);
+        start_send_timer.stop();
+        return;
+    }
+#endif
+
+    if (send_buffer[d] == nullptr)
+        send_buffer[d] = payload.allocate_mpi_buffer(to_node.sites);
+
+    T *buffer = send_buffer[d] + to_node.offset(par);
+
+    gather_comm_elements(d, par, buffer, to_node);
+
+    size_t size_type;
+    MPI_Datatype mpi_type = get_MPI_number_type<T>(size_type);
+    size_t n = to_node.n_sites(par) * sizeof(T) / size_type;
+    int par_i = static_cast<int>(par) - 1;
+
+#ifdef GPU_AWARE_MPI
+    gpuStreamSynchronize(0);
+    // gpuDeviceSynchronize();
+#endif
+
+    start_send_timer.start();
+#ifdef PERSISTENT_GATHERS
+    if (persistent_tag_base >= 0)
+        start_persistent_send(d, par_i, buffer, (int)n, mpi_type, to_node.rank);
+    else
+#endif
+        MPI_Isend(buffer, (int)n, mpi_type, to_node.rank, tag, lattice.mpi_comm_lat,
+                  &send_request[par_i][d]);
+    start_send_timer.stop();
+}
 
 /// start_gather(): Communicate the field at Parity par from Direction
 /// d. Uses accessors to prevent dependency on the layout.
@@ -271,6 +770,10 @@ dir_mask_t Field<T>::start_gather(Direction d, Parity p) const {
     lattice_struct::comm_node_struct &from_node = ci.from_node;
     lattice_struct::comm_node_struct &to_node = ci.to_node;
 
+    // single precision halo?  Halo of the other precision has to be gathered again
+    bool reduced = is_reduced_precision_halo();
+    check_halo_precision(d, reduced);
+
     // check if this is done - either gathered or no comm to be done in the 1st place
 
     if (is_gathered(d, p)) {
@@ -313,63 +816,23 @@ dir_mask_t Field<T>::start_gather(Direction d, Parity p) const {
 
     // Communication hasn't been started yet, do it now
 
-    int par_i = static_cast<int>(par) - 1; // index to dim-3 arrays
-
-    constexpr size_t size = sizeof(T);
-
-    T *receive_buffer;
-    T *send_buffer;
-
-    size_t size_type;
-    MPI_Datatype mpi_type = get_MPI_number_type<T>(size_type);
+#ifdef PERSISTENT_GATHERS
+    // the tag block is taken at the first gather of the field.  All ranks reach this
+    // point for the same gathers, thus the blocks are handed out in the same order
+    if (fs->persistent_tag_base == -2)
+        fs->persistent_tag_base = get_persistent_tag_base();
+#endif
 
     if (from_node.rank != hila::myrank() && boundary_need_to_communicate(d)) {
-
         // HANDLE RECEIVES: get node which will send here
-
-        // buffer can be separate or in Field buffer
-        receive_buffer = fs->get_receive_buffer(d, par, from_node);
-
-        size_t n = from_node.n_sites(par) * size / size_type;
-
-        if (n >= (1ULL << 31)) {
-            hila::out << "Too large MPI message!  Size " << n << '\n';
-            hila::terminate(1);
-        }
-
         post_receive_timer.start();
-
-        // c++ version does not return errors
-        MPI_Irecv(receive_buffer, (int)n, mpi_type, from_node.rank, tag, lattice.mpi_comm_lat,
-                  &fs->receive_request[par_i][d]);
-
+        fs->start_receive(d, par, tag, reduced, from_node);
         post_receive_timer.stop();
     }
 
     if (to_node.rank != hila::myrank() && boundary_need_to_communicate(-d)) {
         // HANDLE SENDS: Copy Field elements on the boundary to a send buffer and send
-
-        unsigned sites = to_node.n_sites(par);
-
-        if (fs->send_buffer[d] == nullptr)
-            fs->send_buffer[d] = fs->payload.allocate_mpi_buffer(to_node.sites);
-
-        send_buffer = fs->send_buffer[d] + to_node.offset(par);
-
-        fs->gather_comm_elements(d, par, send_buffer, to_node);
-
-        size_t n = sites * size / size_type;
-#ifdef GPU_AWARE_MPI
-        gpuStreamSynchronize(0);
-        // gpuDeviceSynchronize();
-#endif
-
-        start_send_timer.start();
-
-        MPI_Isend(send_buffer, (int)n, mpi_type, to_node.rank, tag, lattice.mpi_comm_lat,
-                  &fs->send_request[par_i][d]);
-
-        start_send_timer.stop();
+        fs->start_send(d, par, tag, reduced, to_node);
     }
 
     // and do the boundary shuffle here, after MPI has started
@@ -397,6 +860,10 @@ void Field<T>::wait_gather(Direction d, Parity p) const {
     lattice_struct::comm_node_struct &from_node = ci.from_node;
     lattice_struct::comm_node_struct &to_node = ci.to_node;
 
+    // if the gather is part of a batch, complete the whole batch
+    if (fs->gather_batch != nullptr)
+        hila::complete_gather_batch(fs->gather_batch);
+
     // check if this is done - either gathered or no comm to be done in the 1st place
     if (is_gathered(d, p))
         return;
@@ -455,8 +922,18 @@ void Field<T>::wait_gather(Direction d, Parity p) const {
         if (from_node.rank != hila::myrank() && boundary_need_to_communicate(d)) {
             wait_receive_timer.start();
 
-            MPI_Status status;
-            MPI_Wait(&fs->receive_request[par_i][d], &status);
+            if (fs->reduced_halo_dirs & get_dir_mask(d))
+                fs->wait_reduced_receive(d, par, from_node);
+            else
+#ifdef SHARED_MEMORY_HALO
+            if (hila::shared_halo_base(from_node.rank) != nullptr)
+                fs->wait_shared_receive(d, par, from_node);
+            else
+#endif
+            {
+                MPI_Status status;
+                MPI_Wait(&fs->receive_request[par_i][d], &status);
+            }
 
             wait_receive_timer.stop();
 
@@ -468,8 +945,16 @@ void Field<T>::wait_gather(Direction d, Parity p) const {
         // then wait for the sends
         if (to_node.rank != hila::myrank() && boundary_need_to_communicate(-d)) {
             wait_send_timer.start();
-            MPI_Status status;
-            MPI_Wait(&fs->send_request[par_i][d], &status);
+#ifdef SHARED_MEMORY_HALO
+            if (hila::shared_halo_base(to_node.rank) != nullptr &&
+                (fs->reduced_halo_dirs & get_dir_mask(d)) == 0)
+                fs->wait_shared_send(d, par);
+            else
+#endif
+            {
+                MPI_Status status;
+                MPI_Wait(&fs->send_request[par_i][d], &status);
+            }
             wait_send_timer.stop();
         }
 
@@ -662,15 +1147,11 @@ template <typename T>
 std::vector<T> Field<T>::get_elements(const std::vector<CoordinateVector> &coord_list,
                                       bool bcast) const {
 
-    std::vector<T> res;
-    if (hila::myrank() == 0)
-        res.resize(coord_list.size());
-
-    fs->gather_elements(res.data(), coord_list);
-    if (bcast)
-        hila::broadcast(res);
-
-    return res;
+    // only root asks for the elements, unless they are needed everywhere
+    if (bcast || hila::myrank() == 0)
+        return hila::element_query(coord_list).get(*this);
+    else
+        return hila::element_query(std::vector<CoordinateVector>()).get(*this);
 }
 
 
@@ -761,7 +1242,7 @@ void Field<T>::set_local_data(const std::vector<T> &buffer) {
     T *data = (T *)d_malloc(sizeof(T) * lattice.mynode.volume());
     gpuMemcpy(data, buffer.data(), sizeof(T) * lattice.mynode.volume(), gpuMemcpyHostToDevice);
 #else
-    T *data = buffer.data();
+    const T *data = buffer.data();
 #endif
 
 #pragma hila novector direct_access(data)
@@ -0,0 +1,666 @@
+#ifndef FIELD_EXPR_H_
+#define FIELD_EXPR_H_
+
+//////////////////////////////////////////////////////////////////////
+/// Lazy whole-Field arithmetic with expression templates (opt-in).
+///
+/// Only code that uses hila::lazy() is computed lazily.  The operators + - * / of plain
+/// Fields are unchanged: each returns a new Field, computed in its own site loop, so
+/// existing code such as f = a + b * c - d still makes temporary Fields and a pass over
+/// memory per operator.  To get a single loop it has to be written with hila::lazy(),
+/// or as an onsites() loop.
+///
+/// A Field wrapped in hila::lazy() is instead a small expression object, and the
+/// operators + - * /, unary minus, pow() and the elementwise functions exp(), log(),
+/// sin(), ..., conj(), dagger(), real() and imag() of expressions return expressions
+/// again.  The expression is computed in one site loop when it is assigned to a Field,
+/// so that
+///
+///     f = hila::lazy(a) + hila::lazy(b) * c - d;
+///     f += 2 * exp(hila::lazy(a));
+///
+/// are the same as
+///
+///     onsites(ALL) f[X] = a[X] + b[X] * c[X] - d[X];
+///     onsites(ALL) f[X] = f[X] + 2 * exp(a[X]);
+///
+/// and no temporary Fields are allocated.  An operation between two plain Fields is
+/// computed right away even inside a lazy expression: in hila::lazy(a) + b * c the
+/// product b * c is a temporary Field, computed before the lazy loop.  Write
+/// hila::lazy(b) * c to include it in the loop.
+///
+/// An expression converts to a Field where a Field<T> is expected; in templated contexts
+/// use expr.eval(), which returns the Field.  squarenorm(expr), squarenorm_relative()
+/// and comparison expr == Field are computed without a temporary Field, too.
+///
+/// The expression refers to its Field and expression operands, so it should be used
+/// in the statement where it is made: with "auto e = hila::lazy(a) + b;" the Fields a
+/// and b must outlive e.  Temporary Fields, e.g. Fields returned by functions, are moved
+/// into the expression.
+///
+/// The site loops are written out for up to hila::field_expr_max_fields Field operands
+/// (the same Field can appear several times).  In longer expressions part of the
+/// expression is computed into a temporary Field first.
+///
+/// Inside the loop the expression is a "kernel" object which contains only the
+/// scalars of the expression; the Field elements are passed to it as arguments,
+/// kernel(a[X], b[X], ...).  Thus hilapp sees ordinary Field accesses and the
+/// kernels are plain loop functions on all backends.
+
+#include "plumbing/defs.h"
+
+template <typename T>
+class Field;
+
+namespace hila {
+
+/// Max number of Field operands computed in one loop
+constexpr int field_expr_max_fields = 4;
+
+/// Marker base class of Field expressions
+struct field_expr_base {};
+
+/// is T (after removing references and const) a Field or a Field expression
+template <typename T>
+struct is_field_operand_type : std::is_base_of<field_expr_base, T> {};
+
+template <typename T>
+struct is_field_operand_type<Field<T>> : std::true_type {};
+
+template <typename T>
+struct is_field_operand : is_field_operand_type<std::decay_t<T>> {};
+
+/// is T a Field expression
+template <typename T>
+struct is_field_expr : std::is_base_of<field_expr_base, std::decay_t<T>> {};
+
+/// Element operations of the expressions
+namespace field_expr_op {
+
+// element functions are found from the global namespace (hila::log is the logger)
+using ::abs;
+using ::acos;
+using ::asin;
+using ::atan;
+using ::conj;
+using ::cos;
+using ::dagger;
+using ::exp;
+using ::imag;
+using ::log;
+using ::pow;
+using ::real;
+using ::sin;
+using ::tan;
+
+struct plus {
+    template <typename A, typename B>
+    static inline auto apply(const A &a, const B &b) -> decltype(a + b) {
+        return a + b;
+    }
+};
+
+struct minus {
+    template <typename A, typename B>
+    static inline auto apply(const A &a, const B &b) -> decltype(a - b) {
+        return a - b;
+    }
+};
+
+struct mul {
+    template <typename A, typename B>
+    static inline auto apply(const A &a, const B &b) -> decltype(a * b) {
+        return a * b;
+    }
+};
+
+struct div {
+    template <typename A, typename B>
+    static inline auto apply(const A &a, const B &b) -> decltype(a / b) {
+        return a / b;
+    }
+};
+
+struct negate {
+    template <typename A>
+    static inline auto apply(const A &a) -> decltype(-a) {
+        return -a;
+    }
+};
+
+struct power {
+    template <typename A, typename P>
+    static inline auto apply(const A &a, const P &p) -> decltype(pow(a, p)) {
+        return pow(a, p);
+    }
+};
+
+#define HILA_FIELD_EXPR_ELEMENT_OP(fn)                                                    \
+    struct fn##_op {                                                                     \
+        template <typename A>                                                            \
+        static inline auto apply(const A &a) -> decltype(fn(a)) {                        \
+            return fn(a);                                                                \
+        }                                                                                \
+    };
+
+HILA_FIELD_EXPR_ELEMENT_OP(exp)
+HILA_FIELD_EXPR_ELEMENT_OP(log)
+HILA_FIELD_EXPR_ELEMENT_OP(sin)
+HILA_FIELD_EXPR_ELEMENT_OP(cos)
+HILA_FIELD_EXPR_ELEMENT_OP(tan)
+HILA_FIELD_EXPR_ELEMENT_OP(asin)
+HILA_FIELD_EXPR_ELEMENT_OP(acos)
+HILA_FIELD_EXPR_ELEMENT_OP(atan)
+HILA_FIELD_EXPR_ELEMENT_OP(abs)
+HILA_FIELD_EXPR_ELEMENT_OP(conj)
+HILA_FIELD_EXPR_ELEMENT_OP(dagger)
+HILA_FIELD_EXPR_ELEMENT_OP(real)
+HILA_FIELD_EXPR_ELEMENT_OP(imag)
+
+#undef HILA_FIELD_EXPR_ELEMENT_OP
+
+} // namespace field_expr_op
+
+//////////////////////////////////////////////////////////////////////
+// Kernels: the expression evaluated on the elements of one site.
+// eval<Off>(a...) uses the Field elements a[Off], a[Off+1], ...
+
+/// Element I of the argument list
+template <int I, typename A0, typename... A>
+inline const auto &field_expr_arg(const A0 &a0, const A &...a) {
+    if constexpr (I == 0)
+        return a0;
+    else
+        return field_expr_arg<I - 1>(a...);
+}
+
+struct field_expr_kernel_arg {
+    static constexpr int n_fields = 1;
+
+    template <int Off, typename... A>
+    inline const auto &eval(const A &...a) const {
+        return field_expr_arg<Off>(a...);
+    }
+};
+
+template <typename S>
+struct field_expr_kernel_scalar {
+    static constexpr int n_fields = 0;
+    S val;
+
+    template <int Off, typename... A>
+    inline const S &eval(const A &...a) const {
+        return val;
+    }
+};
+
+template <typename Op, typename K>
+struct field_expr_kernel_unary {
+    static constexpr int n_fields = K::n_fields;
+    K k;
+
+    template <int Off, typename... A>
+    inline auto eval(const A &...a) const {
+        return Op::apply(k.template eval<Off>(a...));
+    }
+
+    template <typename... A>
+    inline auto operator()(const A &...a) const {
+        return eval<0>(a...);
+    }
+};
+
+template <typename Op, typename KL, typename KR>
+struct field_expr_kernel_binary {
+    static constexpr int n_fields = KL::n_fields + KR::n_fields;
+    KL l;
+    KR r;
+
+    template <int Off, typename... A>
+    inline auto eval(const A &...a) const {
+        return Op::apply(l.template eval<Off>(a...), r.template eval<Off + KL::n_fields>(a...));
+    }
+
+    template <typename... A>
+    inline auto operator()(const A &...a) const {
+        return eval<0>(a...);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////
+// The site loops, one for each number of Field operands.  These are written out so
+// that hilapp sees the Field accesses
+
+template <typename T, typename K, typename A0>
+void field_expr_loop(Field<T> &res, Parity par, const K &kernel, const Field<A0> &a0) {
+    onsites(par) res[X] = kernel(a0[X]);
+}
+
+template <typename T, typename K, typename A0, typename A1>
+void field_expr_loop(Field<T> &res, Parity par, const K &kernel, const Field<A0> &a0,
+                     const Field<A1> &a1) {
+    onsites(par) res[X] = kernel(a0[X], a1[X]);
+}
+
+template <typename T, typename K, typename A0, typename A1, typename A2>
+void field_expr_loop(Field<T> &res, Parity par, const K &kernel, const Field<A0> &a0,
+                     const Field<A1> &a1, const Field<A2> &a2) {
+    onsites(par) res[X] = kernel(a0[X], a1[X], a2[X]);
+}
+
+template <typename T, typename K, typename A0, typename A1, typename A2, typename A3>
+void field_expr_loop(Field<T> &res, Parity par, const K &kernel, const Field<A0> &a0,
+                     const Field<A1> &a1, const Field<A2> &a2, const Field<A3> &a3) {
+    onsites(par) res[X] = kernel(a0[X], a1[X], a2[X], a3[X]);
+}
+
+template <typename K, typename A0>
+double field_expr_squarenorm_loop(const K &kernel, const Field<A0> &a0) {
+    double r = 0;
+    onsites(ALL) r += ::squarenorm(kernel(a0[X]));
+    return r;
+}
+
+template <typename K, typename A0, typename A1>
+double field_expr_squarenorm_loop(const K &kernel, const Field<A0> &a0, const Field<A1> &a1) {
+    double r = 0;
+    onsites(ALL) r += ::squarenorm(kernel(a0[X], a1[X]));
+    return r;
+}
+
+template <typename K, typename A0, typename A1, typename A2>
+double field_expr_squarenorm_loop(const K &kernel, const Field<A0> &a0, const Field<A1> &a1,
+                                  const Field<A2> &a2) {
+    double r = 0;
+    onsites(ALL) r += ::squarenorm(kernel(a0[X], a1[X], a2[X]));
+    return r;
+}
+
+template <typename K, typename A0, typename A1, typename A2, typename A3>
+double field_expr_squarenorm_loop(const K &kernel, const Field<A0> &a0, const Field<A1> &a1,
+                                  const Field<A2> &a2, const Field<A3> &a3) {
+    double r = 0;
+    onsites(ALL) r += ::squarenorm(kernel(a0[X], a1[X], a2[X], a3[X]));
+    return r;
+}
+
+template <typename T, typename E, size_t... I>
+inline void assign_field_expr(Field<T> &res, Parity par, const E &e, std::index_sequence<I...>) {
+    field_expr_loop(res, par, e.kernel(), e.template field<I>()...);
+}
+
+/// Compute expression e to res[par] in one site loop
+template <typename T, typename E>
+void assign_field_expr(Field<T> &res, Parity par, const E &e) {
+    static_assert(E::n_fields > 0 && E::n_fields <= field_expr_max_fields,
+                  "Field expression with invalid number of fields");
+    assign_field_expr(res, par, e, std::make_index_sequence<E::n_fields>());
+}
+
+template <typename E, size_t... I>
+inline double field_expr_squarenorm(const E &e, std::index_sequence<I...>) {
+    return field_expr_squarenorm_loop(e.kernel(), e.template field<I>()...);
+}
+
+} // namespace hila
+
+//////////////////////////////////////////////////////////////////////
+/// Base class of Field expressions (CRTP).  It is in the global namespace, like
+/// Field, so that the operators below are found for all expressions
+
+template <typename E>
+class FieldExpr : public hila::field_expr_base {
+  public:
+    const E &self() const {
+        return static_cast<const E &>(*this);
+    }
+    E &self() {
+        return static_cast<E &>(*this);
+    }
+
+    /// Compute the expression to a new Field
+    auto eval() const {
+        Field<typename E::element_type> res;
+        hila::assign_field_expr(res, ALL, self());
+        return res;
+    }
+
+    /// squarenorm of the expression, summed over the lattice
+    double squarenorm() const {
+        return hila::field_expr_squarenorm(self(), std::make_index_sequence<E::n_fields>());
+    }
+};
+
+namespace hila {
+
+//////////////////////////////////////////////////////////////////////
+// The nodes of the expressions.  Each has
+//   element_type     - type of the expression on one site
+//   n_fields         - number of Field operands
+//   field<I>()       - Field operand I
+//   kernel()         - kernel object of the expression
+
+/// Reference to a Field
+template <typename T>
+class field_expr_ref : public FieldExpr<field_expr_ref<T>> {
+    const Field<T> *f;
+
+  public:
+    using element_type = T;
+    static constexpr int n_fields = 1;
+
+    field_expr_ref(const Field<T> &a) : f(&a) {}
+
+    template <int I>
+    const Field<T> &field() const {
+        return *f;
+    }
+    field_expr_kernel_arg kernel() const {
+        return {};
+    }
+};
+
+/// Temporary Field moved into the expression
+template <typename T>
+class field_expr_owned : public FieldExpr<field_expr_owned<T>> {
+    Field<T> f;
+
+  public:
+    using element_type = T;
+    static constexpr int n_fields = 1;
+
+    field_expr_owned(Field<T> &&a) : f(std::move(a)) {}
+
+    template <int I>
+    const Field<T> &field() const {
+        return f;
+    }
+    field_expr_kernel_arg kernel() const {
+        return {};
+    }
+};
+
+/// Scalar, the same on all sites
+template <typename S>
+class field_expr_scalar : public FieldExpr<field_expr_scalar<S>> {
+    S val;
+
+  public:
+    using element_type = S;
+    static constexpr int n_fields = 0;
+
+    field_expr_scalar(const S &s) : val(s) {}
+
+    field_expr_kernel_scalar<S> kernel() const {
+        return {val};
+    }
+};
+
+/// Reference to an expression, used when the expression is not copied
+template <typename E>
+class field_expr_cref : public FieldExpr<field_expr_cref<E>> {
+    const E *e;
+
+  public:
+    using element_type = typename E::element_type;
+    static constexpr int n_fields = E::n_fields;
+
+    field_expr_cref(const E &a) : e(&a) {}
+
+    template <int I>
+    const auto &field() const {
+        return e->template field<I>();
+    }
+    auto kernel() const {
+        return e->kernel();
+    }
+};
+
+template <typename Op, typename E>
+class field_expr_unary : public FieldExpr<field_expr_unary<Op, E>> {
+    E e;
+
+  public:
+    using element_type =
+        std::decay_t<decltype(Op::apply(std::declval<typename E::element_type>()))>;
+    static constexpr int n_fields = E::n_fields;
+
+    field_expr_unary(E &&a) : e(std::move(a)) {}
+
+    template <int I>
+    const auto &field() const {
+        return e.template field<I>();
+    }
+    auto kernel() const {
+        return field_expr_kernel_unary<Op, decltype(e.kernel())>{e.kernel()};
+    }
+};
+
+template <typename Op, typename L, typename R>
+class field_expr_binary : public FieldExpr<field_expr_binary<Op, L, R>> {
+    L l;
+    R r;
+
+  public:
+    using element_type =
+        std::decay_t<decltype(Op::apply(std::declval<typename L::element_type>(),
+                                        std::declval<typename R::element_type>()))>;
+    static constexpr int n_fields = L::n_fields + R::n_fields;
+
+    field_expr_binary(L &&a, R &&b) : l(std::move(a)), r(std::move(b)) {}
+
+    template <int I>
+    const auto &field() const {
+        if constexpr (I < L::n_fields)
+            return l.template field<I>();
+        else
+            return r.template field<I - L::n_fields>();
+    }
+    auto kernel() const {
+        return field_expr_kernel_binary<Op, decltype(l.kernel()), decltype(r.kernel())>{
+            l.kernel(), r.kernel()};
+    }
+};
+
+//////////////////////////////////////////////////////////////////////
+// Operands of the expressions: Fields and expressions are referred to, temporary
+// Fields and expressions are moved in and scalars are stored by value
+
+template <typename T>
+field_expr_ref<T> field_expr_operand(const Field<T> &f) {
+    return field_expr_ref<T>(f);
+}
+
+template <typename T>
+field_expr_owned<T> field_expr_operand(Field<T> &&f) {
+    return field_expr_owned<T>(std::move(f));
+}
+
+template <typename E>
+field_expr_cref<E> field_expr_operand(const FieldExpr<E> &e) {
+    return field_expr_cref<E>(e.self());
+}
+
+template <typename E>
+E field_expr_operand(FieldExpr<E> &&e) {
+    return std::move(e.self());
+}
+
+template <typename S,
+          std::enable_if_t<!is_field_operand<S>::value && is_field_type<S>::value, int> = 0>
+field_expr_scalar<S> field_expr_operand(const S &s) {
+    return field_expr_scalar<S>(s);
+}
+
+template <typename A>
+using field_expr_operand_t = decltype(field_expr_operand(std::declval<A>()));
+
+/// element type of Op applied to operands, for SFINAE in the operators
+template <typename Op, typename A>
+using field_expr_unary_t =
+    decltype(Op::apply(std::declval<typename field_expr_operand_t<A>::element_type>()));
+
+template <typename Op, typename A, typename B>
+using field_expr_binary_t =
+    decltype(Op::apply(std::declval<typename field_expr_operand_t<A>::element_type>(),
+                       std::declval<typename field_expr_operand_t<B>::element_type>()));
+
+/// Combine two nodes.  If the result would have too many Field operands, the operand
+/// with more of them is computed to a temporary Field
+template <typename Op, typename L, typename R>
+auto field_expr_combine(L l, R r) {
+    if constexpr (L::n_fields + R::n_fields <= field_expr_max_fields) {
+        return field_expr_binary<Op, L, R>(std::move(l), std::move(r));
+    } else if constexpr (R::n_fields >= L::n_fields) {
+        return field_expr_combine<Op>(std::move(l),
+                                      field_expr_owned<typename R::element_type>(r.eval()));
+    } else {
+        return field_expr_combine<Op>(field_expr_owned<typename L::element_type>(l.eval()),
+                                      std::move(r));
+    }
+}
+
+template <typename Op, typename A, typename B>
+auto make_field_expr(A &&a, B &&b) {
+    return field_expr_combine<Op>(field_expr_operand(std::forward<A>(a)),
+                                  field_expr_operand(std::forward<B>(b)));
+}
+
+template <typename Op, typename A>
+auto make_field_expr(A &&a) {
+    using E = field_expr_operand_t<A>;
+    return field_expr_unary<Op, E>(field_expr_operand(std::forward<A>(a)));
+}
+
+/// Start a lazy expression from a Field, see the top of this file
+template <typename T>
+field_expr_ref<T> lazy(const Field<T> &f) {
+    return field_expr_ref<T>(f);
+}
+
+template <typename T>
+field_expr_owned<T> lazy(Field<T> &&f) {
+    return field_expr_owned<T>(std::move(f));
+}
+
+} // namespace hila
+
+//////////////////////////////////////////////////////////////////////
+/// Operators + - * / of expressions with Fields, expressions and scalars.  At least
+/// one of the operands is an expression, and the operation must be defined for the
+/// elements
+
+#define HILA_FIELD_EXPR_OPERATOR(oper, op)                                                   \
+    template <typename A, typename B,                                                        \
+              std::enable_if_t<hila::is_field_expr<A>::value ||                              \
+                                   hila::is_field_expr<B>::value,                            \
+                               int> = 0,                                                     \
+              typename = hila::field_expr_binary_t<hila::field_expr_op::op, A, B>>           \
+    auto oper(A &&a, B &&b) {                                                                \
+        return hila::make_field_expr<hila::field_expr_op::op>(std::forward<A>(a),            \
+                                                              std::forward<B>(b));           \
+    }
+
+HILA_FIELD_EXPR_OPERATOR(operator+, plus)
+HILA_FIELD_EXPR_OPERATOR(operator-, minus)
+HILA_FIELD_EXPR_OPERATOR(operator*, mul)
+HILA_FIELD_EXPR_OPERATOR(operator/, div)
+
+/// unary minus
+template <typename A, std::enable_if_t<hila::is_field_expr<A>::value, int> = 0,
+          typename = hila::field_expr_unary_t<hila::field_expr_op::negate, A>>
+auto operator-(A &&a) {
+    return hila::make_field_expr<hila::field_expr_op::negate>(std::forward<A>(a));
+}
+
+/// pow(expression, scalar)
+template <typename A, typename P,
+          std::enable_if_t<hila::is_field_expr<A>::value && !hila::is_field_operand<P>::value,
+                           int> = 0,
+          typename = hila::field_expr_binary_t<hila::field_expr_op::power, A, P>>
+auto pow(A &&a, const P &p) {
+    return hila::make_field_expr<hila::field_expr_op::power>(std::forward<A>(a), p);
+}
+
+///////////////////////////////////////////////////////////////////////
+/// Elementwise functions of expressions, if implemented for the elements
+
+#define HILA_FIELD_EXPR_FUNCTION(fn)                                                         \
+    template <typename A, std::enable_if_t<hila::is_field_expr<A>::value, int> = 0,          \
+              typename = hila::field_expr_unary_t<hila::field_expr_op::fn##_op, A>>         \
+    auto fn(A &&a) {                                                                         \
+        return hila::make_field_expr<hila::field_expr_op::fn##_op>(std::forward<A>(a));      \
+    }
+
+HILA_FIELD_EXPR_FUNCTION(exp)
+HILA_FIELD_EXPR_FUNCTION(log)
+HILA_FIELD_EXPR_FUNCTION(sin)
+HILA_FIELD_EXPR_FUNCTION(cos)
+HILA_FIELD_EXPR_FUNCTION(tan)
+HILA_FIELD_EXPR_FUNCTION(asin)
+HILA_FIELD_EXPR_FUNCTION(acos)
+HILA_FIELD_EXPR_FUNCTION(atan)
+HILA_FIELD_EXPR_FUNCTION(abs)
+HILA_FIELD_EXPR_FUNCTION(conj)
+HILA_FIELD_EXPR_FUNCTION(dagger)
+HILA_FIELD_EXPR_FUNCTION(real)
+HILA_FIELD_EXPR_FUNCTION(imag)
+
+#undef HILA_FIELD_EXPR_OPERATOR
+#undef HILA_FIELD_EXPR_FUNCTION
+
+///////////////////////////////////////////////////////////////////////
+/// Compound assignments with expressions: f += expr is computed as f = f + expr
+
+#define HILA_FIELD_EXPR_COMPOUND(oper, op)                                                   \
+    template <typename T, typename E,                                                        \
+              std::enable_if_t<std::is_convertible<hila::field_expr_binary_t<                \
+                                                       hila::field_expr_op::op, Field<T>, E>, \
+                                                   T>::value,                                \
+                               int> = 0>                                                     \
+    Field<T> &oper(Field<T> &f, const FieldExpr<E> &e) {                                     \
+        hila::assign_field_expr(f, ALL, hila::make_field_expr<hila::field_expr_op::op>(f, e)); \
+        return f;                                                                            \
+    }
+
+HILA_FIELD_EXPR_COMPOUND(operator+=, plus)
+HILA_FIELD_EXPR_COMPOUND(operator-=, minus)
+HILA_FIELD_EXPR_COMPOUND(operator*=, mul)
+HILA_FIELD_EXPR_COMPOUND(operator/=, div)
+
+#undef HILA_FIELD_EXPR_COMPOUND
+
+/// squarenorm of an expression, without a temporary Field
+template <typename E>
+double squarenorm(const FieldExpr<E> &e) {
+    return e.squarenorm();
+}
+
+template <typename E>
+double norm(const FieldExpr<E> &e) {
+    return sqrt(e.squarenorm());
+}
+
+/// squarenorm of a - b, where a or b is an expression
+template <typename A, typename B,
+          std::enable_if_t<(hila::is_field_expr<A>::value && hila::is_field_operand<B>::value) ||
+                               (hila::is_field_operand<A>::value && hila::is_field_expr<B>::value),
+                           int> = 0,
+          typename = hila::field_expr_binary_t<hila::field_expr_op::minus, const A &, const B &>>
+double squarenorm_relative(const A &a, const B &b) {
+    return (hila::field_expr_operand(a) - hila::field_expr_operand(b)).squarenorm();
+}
+
+/// Comparison of a Field and an expression, see Field::operator==
+template <typename T, typename E>
+bool operator==(const Field<T> &f, const FieldExpr<E> &e) {
+    hila::scalar_type<T> epsilon = 0;
+    return (f - e).squarenorm() <= epsilon;
+}
+
+template <typename T, typename E>
+bool operator==(const FieldExpr<E> &e, const Field<T> &f) {
+    return f == e;
+}
+
+#endif
@@ -5,6 +5,7 @@
 // This file collects Field<> I/O routines
 
 #include "plumbing/field.h"
+#include "plumbing/shard_io.h"
 
 namespace hila {
 // Define this as template, in order to avoid code generation if the function is not needed -
@@ -76,7 +77,8 @@ bool close_file(const std::string &filename, S &fstream) {
 
 /// Write the field to a file stream
 template <typename T>
-void Field<T>::write(std::ofstream &outputfile, bool binary, int precision) const {
+void Field<T>::write(std::ofstream &outputfile, bool binary, int precision,
+                     hila::site_checksum *checksum) const {
     constexpr size_t sites_per_write = WRITE_BUFFER_SIZE / sizeof(T);
     constexpr size_t write_size = sites_per_write * sizeof(T);
 
@@ -99,6 +101,9 @@ void Field<T>::write(std::ofstream &outputfile, bool binary, int precision) cons
         if (hila::myrank() == 0) {
             if (binary) {
                 outputfile.write((char *)buffer, sites * sizeof(T));
+                if (checksum)
+                    for (size_t j = 0; j < sites; j++)
+                        checksum->add(i + j, buffer + j, sizeof(T));
             } else {
                 for (size_t j = 0; j < sites; j++) {
                     outputfile << buffer[j] << '\n';
@@ -110,11 +115,34 @@ void Field<T>::write(std::ofstream &outputfile, bool binary, int precision) cons
     std::free(buffer);
 }
 
+/// Write the field with collective MPI-IO to an open MPI file, starting at byte offset.
+/// Each rank writes its own node block directly; the file layout is the same as
+/// with the serial binary write
+template <typename T>
+void Field<T>::write(MPI_File fh, MPI_Offset offset, hila::site_checksum *checksum) const {
+    std::vector<T> buffer;
+    copy_local_data(buffer);
+    hila::write_node_block(fh, offset, buffer.data(), sizeof(T));
+    if (checksum)
+        checksum->add_node_block(buffer.data(), sizeof(T));
+}
+
 /// Write the Field to a named file replacing the file
 template <typename T>
 void Field<T>::write(const std::string &filename, bool binary, int precision) const {
     std::ofstream outputfile;
     hila::open_output_file(filename, outputfile, binary);
+#ifdef PARALLEL_IO
+    if (binary) {
+        // file is now truncated, write the content collectively
+        hila::close_file(filename, outputfile);
+        MPI_File fh;
+        hila::open_mpi_file(filename, fh, true);
+        write(fh, 0);
+        hila::close_mpi_file(filename, fh);
+        return;
+    }
+#endif
     write(outputfile, binary, precision);
     hila::close_file(filename, outputfile);
 }
@@ -131,20 +159,40 @@ static void write_fields(std::ofstream &outputfile, Field<T> &next, fieldtypes &
     write_fields(outputfile, fields...);
 }
 
+/// Write a list of fields collectively to an MPI file, starting from offset
+template <typename T>
+static void write_fields(MPI_File fh, MPI_Offset offset, Field<T> &last) {
+    last.write(fh, offset);
+}
+
+template <typename T, typename... fieldtypes>
+static void write_fields(MPI_File fh, MPI_Offset offset, Field<T> &next, fieldtypes &...fields) {
+    next.write(fh, offset);
+    write_fields(fh, offset + lattice.volume() * sizeof(T), fields...);
+}
+
 /// Write a list of fields to a file
 template <typename... fieldtypes>
 static void write_fields(const std::string &filename, fieldtypes &...fields) {
     std::ofstream outputfile;
     hila::open_output_file(filename, outputfile);
+#ifdef PARALLEL_IO
+    hila::close_file(filename, outputfile);
+    MPI_File fh;
+    hila::open_mpi_file(filename, fh, true);
+    write_fields(fh, 0, fields...);
+    hila::close_mpi_file(filename, fh);
+#else
     write_fields(outputfile, fields...);
     hila::close_file(filename, outputfile);
+#endif
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 
 /// Read the Field from a stream
 template <typename T>
-void Field<T>::read(std::ifstream &inputfile) {
+void Field<T>::read(std::ifstream &inputfile, hila::site_checksum *checksum) {
     constexpr size_t sites_per_read = WRITE_BUFFER_SIZE / sizeof(T);
     constexpr size_t read_size = sites_per_read * sizeof(T);
 
@@ -165,8 +213,12 @@ void Field<T>::read(std::ifstream &inputfile) {
         if (sites < sites_per_read)
             coord_list.resize(sites);
 
-        if (hila::myrank() == 0)
+        if (hila::myrank() == 0) {
             inputfile.read((char *)buffer, sites * sizeof(T));
+            if (checksum)
+                for (size_t j = 0; j < sites; j++)
+                    checksum->add(i + j, buffer + j, sizeof(T));
+        }
 
         fs->scatter_elements(buffer, coord_list);
     }
@@ -174,34 +226,97 @@ void Field<T>::read(std::ifstream &inputfile) {
     std::free(buffer);
 }
 
+/// Read the field with collective MPI-IO from an open MPI file, starting at byte offset
+template <typename T>
+void Field<T>::read(MPI_File fh, MPI_Offset offset, hila::site_checksum *checksum) {
+    if (!this->is_allocated())
+        this->allocate();
+
+    std::vector<T> buffer(lattice.mynode.volume());
+    hila::read_node_block(fh, offset, buffer.data(), sizeof(T));
+    if (checksum)
+        checksum->add_node_block(buffer.data(), sizeof(T));
+    set_local_data(buffer);
+}
+
 // Read Field contents from the beginning of a file
 template <typename T>
 void Field<T>::read(const std::string &filename) {
+#ifdef PARALLEL_IO
+    MPI_File fh;
+    hila::open_mpi_file(filename, fh, false);
+    read(fh, 0);
+    hila::close_mpi_file(filename, fh);
+#else
     std::ifstream inputfile;
     hila::open_input_file(filename, inputfile);
     read(inputfile);
     hila::close_file(filename, inputfile);
+#endif
+}
+
+/// Write the node block of each rank to its own shard file, see shard_io.h
+template <typename T>
+void Field<T>::write_sharded(const std::string &filename) const {
+    std::vector<T> local;
+    copy_local_data(local);
+    hila::write_shards(filename, {local.data()}, sizeof(T));
+}
+
+/// Sharded write by a background thread from a copy of the node block
+template <typename T>
+void Field<T>::write_async(const std::string &filename) const {
+    auto staging = std::make_shared<std::vector<T>>();
+    copy_local_data(*staging);
+    hila::write_shards_async(filename, {staging->data()}, sizeof(T), staging);
+}
+
+/// Read a sharded file set, also when written with a different node layout
+template <typename T>
+void Field<T>::read_sharded(const std::string &filename) {
+    std::vector<T> local(lattice.mynode.volume());
+    hila::read_shards(filename, {local.data()}, sizeof(T));
+    set_local_data(local);
 }
 
 // Read a list of fields from an input stream
 template <typename T>
 static void read_fields(std::ifstream &inputfile, Field<T> &last) {
-    last.read_from_stream(inputfile);
+    last.read(inputfile);
 }
 
 template <typename T, typename... fieldtypes>
 static void read_fields(std::ifstream &inputfile, Field<T> &next, fieldtypes &...fields) {
-    next.read_from_stream(inputfile);
+    next.read(inputfile);
     read_fields(inputfile, fields...);
 }
 
+// Read a list of fields collectively from an MPI file, starting from offset
+template <typename T>
+static void read_fields(MPI_File fh, MPI_Offset offset, Field<T> &last) {
+    last.read(fh, offset);
+}
+
+template <typename T, typename... fieldtypes>
+static void read_fields(MPI_File fh, MPI_Offset offset, Field<T> &next, fieldtypes &...fields) {
+    next.read(fh, offset);
+    read_fields(fh, offset + lattice.volume() * sizeof(T), fields...);
+}
+
 // Read a list of fields from a file
 template <typename... fieldtypes>
 static void read_fields(const std::string &filename, fieldtypes &...fields) {
+#ifdef PARALLEL_IO
+    MPI_File fh;
+    hila::open_mpi_file(filename, fh, false);
+    read_fields(fh, 0, fields...);
+    hila::close_mpi_file(filename, fh);
+#else
     std::ifstream inputfile;
     hila::open_input_file(filename, inputfile);
     read_fields(inputfile, fields...);
     hila::close_file(filename, inputfile);
+#endif
 }
 
 
@@ -0,0 +1,147 @@
+#include <map>
+#include <cstddef>
+
+#include "plumbing/defs.h"
+#include "plumbing/lattice.h"
+#include "plumbing/com_mpi.h"
+#include "plumbing/gather_batch.h"
+
+//////////////////////////////////////////////////////////////////
+/// Batched gathers - see gather_batch.h
+//////////////////////////////////////////////////////////////////
+
+namespace hila {
+
+// keep the parts of the send buffer aligned
+static size_t aligned_size(size_t n) {
+    constexpr size_t align = alignof(std::max_align_t);
+    return (n + align - 1) / align * align;
+}
+
+// MPI datatype of the parts of a message: blocks of bytes at absolute addresses,
+// used with MPI_BOTTOM
+struct message_blocks {
+    std::vector<int> bytes;
+    std::vector<MPI_Aint> address;
+
+    void add(const char *p, size_t n) {
+        MPI_Aint a;
+        MPI_Get_address(p, &a);
+        address.push_back(a);
+        bytes.push_back((int)n);
+    }
+
+    MPI_Datatype type() const {
+        MPI_Datatype t;
+        MPI_Type_create_hindexed((int)bytes.size(), bytes.data(), address.data(), MPI_BYTE,
+                                 &t);
+        MPI_Type_commit(&t);
+        return t;
+    }
+};
+
+void complete_gather_batch(gather_batch *batch) {
+    batch->wait();
+}
+
+void gather_batch::start() {
+
+    if (active)
+        wait();
+
+    // tags must be in sync on all ranks, take it before anything else
+    int tag = get_next_msg_tag();
+
+    // the parts of each neighbour are in the order of the entries, which is the same
+    // on the sending and receiving side
+    std::map<int, size_t> send_size;
+    std::map<int, message_blocks> receive_blocks;
+    for (auto &e : entries) {
+        e->prepare(this);
+        if (e->batched && e->send_rank >= 0) {
+            e->send_offset = send_size[e->send_rank];
+            send_size[e->send_rank] += aligned_size(e->send_bytes);
+        }
+        if (e->batched && e->receive_rank >= 0)
+            receive_blocks[e->receive_rank].add(e->receive_buffer(), e->receive_bytes);
+    }
+
+    receives.resize(receive_blocks.size());
+    int i = 0;
+    for (auto &rb : receive_blocks) {
+        message &m = receives[i++];
+        m.rank = rb.first;
+
+        post_receive_timer.start();
+        MPI_Datatype type = rb.second.type();
+        MPI_Irecv(MPI_BOTTOM, 1, type, m.rank, tag, lattice.mpi_comm_lat, &m.request);
+        // freeing the type does not affect the pending receive
+        MPI_Type_free(&type);
+        post_receive_timer.stop();
+    }
+
+    sends.resize(send_size.size());
+    i = 0;
+    for (auto &ss : send_size) {
+        message &m = sends[i++];
+        m.rank = ss.first;
+        m.buffer.resize(ss.second);
+        assert(ss.second < (1ULL << 31) && "Too large MPI message in gather_batch");
+
+        // the alignment gaps are not sent
+        message_blocks blocks;
+        for (auto &e : entries) {
+            if (e->batched && e->send_rank == m.rank) {
+                e->pack(m.buffer.data() + e->send_offset);
+                blocks.add(m.buffer.data() + e->send_offset, e->send_bytes);
+            }
+        }
+
+        start_send_timer.start();
+        MPI_Datatype type = blocks.type();
+        MPI_Isend(MPI_BOTTOM, 1, type, m.rank, tag, lattice.mpi_comm_lat, &m.request);
+        MPI_Type_free(&type);
+        start_send_timer.stop();
+    }
+
+    for (auto &e : entries)
+        e->start_local();
+
+    active = true;
+}
+
+void gather_batch::wait() {
+
+    if (!active)
+        return;
+    active = false;
+
+    for (auto &m : receives) {
+        wait_receive_timer.start();
+        MPI_Wait(&m.request, MPI_STATUS_IGNORE);
+        wait_receive_timer.stop();
+
+        for (auto &e : entries) {
+            if (e->batched && e->receive_rank == m.rank)
+                e->unpack();
+        }
+    }
+
+    for (auto &m : sends) {
+        wait_send_timer.start();
+        MPI_Wait(&m.request, MPI_STATUS_IGNORE);
+        wait_send_timer.stop();
+    }
+
+    // batched gathers first, so that waits of the others do not come back here
+    for (auto &e : entries) {
+        if (e->batched)
+            e->finish();
+    }
+    for (auto &e : entries) {
+        if (!e->batched)
+            e->finish();
+    }
+}
+
+} // namespace hila
@@ -0,0 +1,196 @@
+#ifndef GATHER_BATCH_H_
+#define GATHER_BATCH_H_
+
+//////////////////////////////////////////////////////////////////////
+/// Batched halo exchange of several fields and directions.
+///
+/// Field::start_gather() sends one message per field, direction and parity.  A
+/// gather_batch collects a set of gathers and sends everything going to the same
+/// neighbour rank in one message, e.g.
+///
+///     hila::gather_batch gathers;
+///     foralldir(d) gathers.add(v, d, par).add(w[d], -d, par);
+///     gathers.start();
+///     ...                 // computation which does not need the halos
+///     gathers.wait();     // optional: a loop using v[X+d] completes the batch too
+///
+/// The messages are received directly to the halo buffers of the fields, through an MPI
+/// datatype listing the buffers; the send side packs the boundary sites to one buffer.
+/// The gathers are marked started in the fields, so that the onsites() loops find them;
+/// the first wait_gather() of any field in the batch completes the whole batch.
+/// Changing a field in the batch completes the batch as well.  Gathers which are
+/// already done or going on are not repeated.  The batch can be restarted with start()
+/// after it is complete; the message buffers are reused.
+///
+/// All ranks must build the batch in the same order.  On GPU backends, and for fields
+/// with single precision halos, the gathers are started individually.
+
+#include "plumbing/defs.h"
+#include "plumbing/field.h"
+
+#include <memory>
+
+template <typename T>
+class GaugeField;
+
+namespace hila {
+
+class gather_batch {
+  private:
+    /// One gather of the batch, type-independent interface
+    struct entry_base {
+        bool batched = false;         // false: done by Field::start_gather/wait_gather
+        int send_rank, receive_rank;  // -1 if nothing to send/receive
+        size_t send_bytes, receive_bytes;
+        size_t send_offset; // position in the send buffer
+
+        virtual ~entry_base() = default;
+
+        /// check the gather status and mark the gather started, or start it individually
+        virtual void prepare(gather_batch *batch) = 0;
+        virtual void pack(char *buffer) const = 0;
+        /// where the received data goes, and its placement after the receive
+        virtual char *receive_buffer() = 0;
+        virtual void unpack() = 0;
+        /// node-local part of the gather, after the messages are on their way
+        virtual void start_local() = 0;
+        virtual void finish() = 0;
+    };
+
+    template <typename T>
+    struct entry : public entry_base {
+        const Field<T> *field;
+        Direction dir;
+        Parity par;
+
+        entry(const Field<T> &f, Direction d, Parity p) : field(&f), dir(d), par(p) {}
+
+        void prepare(gather_batch *batch) override {
+            send_rank = receive_rank = -1;
+            send_bytes = receive_bytes = 0;
+            batched = false;
+
+            const Field<T> &f = *field;
+            f.check_alloc();
+            bool reduced = f.is_reduced_precision_halo();
+            f.check_halo_precision(dir, reduced);
+
+#if !defined(CUDA) && !defined(HIP)
+            const auto &ci = lattice.nn_comminfo[dir];
+            bool remote = ci.from_node.rank != hila::myrank() || ci.to_node.rank != hila::myrank();
+
+            // batch only gathers with nothing going on, otherwise let start_gather decide
+            if (remote && !reduced && !f.is_gathered(dir, par) && f.gather_not_done(dir, par) &&
+                f.gather_not_done(dir, ALL) &&
+                (par != ALL || (f.gather_not_done(dir, EVEN) && f.gather_not_done(dir, ODD)))) {
+
+                batched = true;
+                f.mark_gather_started(dir, par);
+                f.fs->gather_batch = batch;
+
+                if (ci.from_node.rank != hila::myrank() && f.boundary_need_to_communicate(dir)) {
+                    receive_rank = ci.from_node.rank;
+                    receive_bytes = ci.from_node.n_sites(par) * sizeof(T);
+                }
+                if (ci.to_node.rank != hila::myrank() && f.boundary_need_to_communicate(-dir)) {
+                    send_rank = ci.to_node.rank;
+                    send_bytes = ci.to_node.n_sites(par) * sizeof(T);
+                }
+                return;
+            }
+#endif
+            f.start_gather(dir, par);
+        }
+
+        void pack(char *buffer) const override {
+            field->fs->gather_comm_elements(dir, par, reinterpret_cast<T *>(buffer),
+                                            lattice.nn_comminfo[dir].to_node);
+        }
+
+        char *receive_buffer() override {
+            return reinterpret_cast<char *>(
+                field->fs->get_receive_buffer(dir, par, lattice.nn_comminfo[dir].from_node));
+        }
+
+        void unpack() override {
+#ifndef VANILLA
+            const auto &from_node = lattice.nn_comminfo[dir].from_node;
+            T *rb = field->fs->get_receive_buffer(dir, par, from_node);
+            field->fs->place_comm_elements(dir, par, rb, from_node);
+#endif
+        }
+
+        void start_local() override {
+            if (batched)
+                field->fs->set_local_boundary_elements(dir, par);
+        }
+
+        void finish() override {
+            if (batched) {
+                field->mark_gathered(dir, par);
+                field->fs->gather_batch = nullptr;
+                lattice.n_gather_done += 1;
+            } else {
+                field->wait_gather(dir, par);
+            }
+        }
+    };
+
+    std::vector<std::unique_ptr<entry_base>> entries;
+
+    // one message to / from each neighbour rank, only sends need a buffer
+    struct message {
+        int rank;
+        std::vector<char> buffer;
+        MPI_Request request;
+    };
+    std::vector<message> sends, receives;
+
+    bool active = false;
+
+  public:
+    gather_batch() = default;
+    gather_batch(const gather_batch &) = delete;
+    gather_batch &operator=(const gather_batch &) = delete;
+
+    ~gather_batch() {
+        if (active && !hila::about_to_finish)
+            wait();
+    }
+
+    /// Add gather of field f from direction d, parity par
+    template <typename T>
+    gather_batch &add(const Field<T> &f, Direction d, Parity par = ALL) {
+        assert(!active && "gather_batch: cannot add to an active batch");
+        entries.emplace_back(new entry<T>(f, d, par));
+        return *this;
+    }
+
+    /// Add gathers of all links of U from direction d
+    template <typename T>
+    gather_batch &add(const GaugeField<T> &U, Direction d, Parity par = ALL) {
+        foralldir(d1) add(U[d1], d, par);
+        return *this;
+    }
+
+    /// Remove all gathers from the batch
+    void clear() {
+        if (active)
+            wait();
+        entries.clear();
+    }
+
+    /// Start the gathers: one message to / from each neighbour rank. Collective
+    void start();
+
+    /// Complete the gathers.  No-op if the batch is not active
+    void wait();
+
+    bool is_active() const {
+        return active;
+    }
+};
+
+} // namespace hila
+
+#endif
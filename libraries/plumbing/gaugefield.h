@@ -2,15 +2,47 @@
 #define GAUGEFIELD_H_
 
 #include "hila.h"
+#include "plumbing/shard_io.h"
+#include "plumbing/lime_io.h"
+
+namespace hila {
+/// Encodings of the links in configuration files written by GaugeField::config_write().
+/// These can be combined, e.g. compact | single_precision
+namespace config_encoding {
+constexpr int full = 0;             ///< links stored as they are
+constexpr int compact = 1;          ///< only the first N-1 rows of SU(N) matrices
+constexpr int single_precision = 2; ///< floating point numbers stored as float
+} // namespace config_encoding
+
+// memory mapped reader of config files, see mapped_config.h
+template <typename T>
+class mapped_config;
+} // namespace hila
 
 template <typename T>
 class GaugeField {
   private:
     std::array<Field<T>, NDIM> fdir;
 
+    // mapped_config checks the file header with the constants below
+    friend class hila::mapped_config<T>;
+
     // somewhat arbitrary fingerprint flag for configuration files
     static constexpr int64_t config_flag = 394824242;
 
+    // fingerprint of config files with extended header, which records the link encoding
+    // and checksum.  config_write() uses it only for an encoded or checksummed file,
+    // otherwise the file has the original header: config_flag, NDIM, sizeof(T) and
+    // lattice size
+    static constexpr int64_t config_flag_encoded = 394824243;
+
+    // int64 words in the extended header: flag, number of words, NDIM, sizeof(T),
+    // lattice size, encoding, and checksum a and b if the file has a checksum.
+    // Readers skip unknown words at the end
+    static constexpr int64_t config_header_words = 7 + NDIM;
+    static constexpr int64_t config_encoding_word = 4 + NDIM;
+    static constexpr int64_t config_checksum_word = 5 + NDIM;
+
   public:
     // Default constructor
     GaugeField() = default;
@@ -81,11 +113,26 @@ class GaugeField {
         }
     }
 
+    /// Collective MPI-IO write, directions follow each other starting from offset
+    void write(MPI_File fh, MPI_Offset offset) const {
+        foralldir(d) {
+            fdir[d].write(fh, offset + (int64_t)d * lattice.volume() * sizeof(T));
+        }
+    }
+
     void write(const std::string &filename) const {
         std::ofstream outputfile;
         hila::open_output_file(filename, outputfile);
+#ifdef PARALLEL_IO
+        hila::close_file(filename, outputfile);
+        MPI_File fh;
+        hila::open_mpi_file(filename, fh, true);
+        write(fh, 0);
+        hila::close_mpi_file(filename, fh);
+#else
         write(outputfile);
         hila::close_file(filename, outputfile);
+#endif
     }
 
     void read(std::ifstream &inputfile) {
@@ -94,87 +141,535 @@ class GaugeField {
         }
     }
 
+    void read(MPI_File fh, MPI_Offset offset) {
+        foralldir(d) {
+            fdir[d].read(fh, offset + (int64_t)d * lattice.volume() * sizeof(T));
+        }
+    }
+
     void read(const std::string &filename) {
+#ifdef PARALLEL_IO
+        MPI_File fh;
+        hila::open_mpi_file(filename, fh, false);
+        read(fh, 0);
+        hila::close_mpi_file(filename, fh);
+#else
         std::ifstream inputfile;
         hila::open_input_file(filename, inputfile);
         read(inputfile);
         hila::close_file(filename, inputfile);
+#endif
     }
 
-    /// config_write writes the gauge field to file, with additional "verifying" header
+    /// config_write writes the gauge field to file, with additional "verifying" header.
+    /// With encoding other than hila::config_encoding::full the links are stored
+    /// compactly, and with checksum = true the site checksum of the data (see checksum.h)
+    /// is stored; config_read verifies it.  Either of these needs the extended header,
+    /// otherwise the file has the original layout readable by older codes.
+
+    void config_write(const std::string &filename, int encoding = hila::config_encoding::full,
+                      bool checksum = false) const {
+
+        check_config_encoding(encoding);
 
-    void config_write(const std::string &filename) const {
         std::ofstream outputfile;
         hila::open_output_file(filename, outputfile);
 
-        // write header
+        // write header, the checksum is filled in after the links
+        int64_t header_size = 0;
         if (hila::myrank() == 0) {
-            int64_t f = config_flag;
-            outputfile.write(reinterpret_cast<char *>(&f), sizeof(int64_t));
-            f = NDIM;
-            outputfile.write(reinterpret_cast<char *>(&f), sizeof(int64_t));
-            f = sizeof(T);
-            outputfile.write(reinterpret_cast<char *>(&f), sizeof(int64_t));
-
-            foralldir(d) {
-                f = lattice.size(d);
-                outputfile.write(reinterpret_cast<char *>(&f), sizeof(int64_t));
-            }
+            header_size = write_config_header(outputfile, encoding, checksum);
+        }
+        hila::broadcast(header_size);
+
+        hila::site_checksum cs;
+        hila::site_checksum *csp = checksum ? &cs : nullptr;
+        using namespace hila::config_encoding;
+        if (encoding == full) {
+            write_config_links<link_scalar, n_full>(outputfile, filename, header_size, csp);
+        } else if (encoding == compact) {
+            write_config_links<link_scalar, n_compact>(outputfile, filename, header_size, csp);
+        } else if (encoding == single_precision) {
+            write_config_links<float, n_full>(outputfile, filename, header_size, csp);
+        } else {
+            write_config_links<float, n_compact>(outputfile, filename, header_size, csp);
         }
 
-        write(outputfile);
-        hila::close_file(filename, outputfile);
+        if (checksum)
+            write_config_checksum(filename, cs);
     }
 
+    /// config_read reads the configuration written by config_write, with any encoding.
+    /// If the file has a checksum, it is verified.
     void config_read(const std::string &filename) {
         std::ifstream inputfile;
         hila::open_input_file(filename, inputfile);
-        std::string conferr("CONFIG ERROR in file " + filename + ": ");
 
-        // read header
+        config_header_info header;
         bool ok = true;
-        int64_t f;
         if (hila::myrank() == 0) {
-            inputfile.read(reinterpret_cast<char *>(&f), sizeof(int64_t));
-            ok = (f == config_flag);
-            if (!ok)
-                hila::out0 << conferr << "wrong id, should be " << config_flag << " is " << f
-                           << '\n';
+            ok = read_config_header(inputfile, filename, header);
+        }
+
+        if (!hila::broadcast(ok)) {
+            hila::terminate(1);
+        }
+        hila::broadcast(header);
+
+        hila::site_checksum checksum;
+        using namespace hila::config_encoding;
+        if (header.encoding == full) {
+            read_config_links<link_scalar, n_full>(inputfile, filename, header.size, checksum);
+        } else if (header.encoding == compact) {
+            read_config_links<link_scalar, n_compact>(inputfile, filename, header.size,
+                                                      checksum);
+        } else if (header.encoding == single_precision) {
+            read_config_links<float, n_full>(inputfile, filename, header.size, checksum);
+        } else {
+            read_config_links<float, n_compact>(inputfile, filename, header.size, checksum);
+        }
+
+        if (header.has_checksum) {
+            checksum.reduce();
+            if (checksum.a != header.checksum_a || checksum.b != header.checksum_b) {
+                hila::out0 << "CONFIG ERROR in file " << filename << ": checksum mismatch, "
+                           << std::hex << "file " << header.checksum_a << ' '
+                           << header.checksum_b << ", data " << checksum.a << ' ' << checksum.b
+                           << std::dec << '\n';
+                hila::terminate(1);
+            }
+        }
+    }
+
+  private:
+    ////////////////////////////////////////////////////////
+    /// Helpers for config_write/read
+
+    using link_scalar = hila::scalar_type<T>;
+
+    // number of scalars in a link, and the number stored in compact encoding
+    // (first N-1 rows of SU(N) matrix - these are at the beginning of the storage)
+    static constexpr int n_full = sizeof(T) / sizeof(link_scalar);
+
+    template <typename U = T>
+    static constexpr int compact_numbers() {
+        if constexpr (hila::is_SU_matrix<U>::value)
+            return 2 * U::rows() * (U::rows() - 1);
+        else
+            return n_full;
+    }
+    static constexpr int n_compact = compact_numbers();
+
+    // header content needed in reading
+    struct config_header_info {
+        int64_t encoding, size; // size in bytes
+        bool has_checksum;
+        uint32_t checksum_a, checksum_b;
+    };
+
+    static void check_config_encoding(int encoding) {
+        using namespace hila::config_encoding;
+        if (encoding < 0 || encoding > (compact | single_precision)) {
+            hila::out0 << "CONFIG ERROR: unknown encoding " << encoding << '\n';
+            hila::terminate(1);
+        }
+        if ((encoding & compact) && !hila::is_SU_matrix<T>::value) {
+            hila::out0 << "CONFIG ERROR: compact encoding is available only for SU(N) matrices\n";
+            hila::terminate(1);
+        }
+    }
+
+    // write the header, called only by rank 0.  The extended header is used only if
+    // needed, checksum words are left 0.  Returns the header size in bytes
+    int64_t write_config_header(std::ofstream &outputfile, int encoding, bool checksum) const {
+        std::vector<int64_t> h;
+        if (encoding == hila::config_encoding::full && !checksum) {
+            h = {config_flag, NDIM, (int64_t)sizeof(T)};
+            foralldir(d) h.push_back(lattice.size(d));
+        } else {
+            h = {config_flag_encoded, checksum ? config_header_words : config_checksum_word, NDIM,
+                 (int64_t)sizeof(T)};
+            foralldir(d) h.push_back(lattice.size(d));
+            h.push_back(encoding);
+            if (checksum) {
+                h.push_back(0);
+                h.push_back(0);
+            }
         }
 
-        if (ok && hila::myrank() == 0) {
+        outputfile.write(reinterpret_cast<char *>(h.data()), h.size() * sizeof(int64_t));
+        return h.size() * sizeof(int64_t);
+    }
+
+    // combine the checksum and put it to the header
+    void write_config_checksum(const std::string &filename, hila::site_checksum &checksum) const {
+        checksum.reduce();
+        bool ok = true;
+        if (hila::myrank() == 0) {
+            std::fstream f(filename, std::ios::in | std::ios::out | std::ios::binary);
+            int64_t cs[2] = {checksum.a, checksum.b};
+            f.seekp(config_checksum_word * sizeof(int64_t));
+            f.write(reinterpret_cast<char *>(cs), 2 * sizeof(int64_t));
+            f.close();
+            ok = !f.fail();
+        }
+        if (!hila::broadcast(ok)) {
+            hila::out0 << "ERROR in writing checksum to file " << filename << '\n';
+            hila::terminate(4);
+        }
+    }
+
+
+
+    // read and check the header on rank 0.  Old style headers (config_flag) have
+    // no encoding or checksum
+    bool read_config_header(std::ifstream &inputfile, const std::string &filename,
+                            config_header_info &header) const {
+
+        std::string conferr("CONFIG ERROR in file " + filename + ": ");
+
+        int64_t f;
+        int64_t words = 3 + NDIM;
+        header.encoding = hila::config_encoding::full;
+        header.has_checksum = false;
+        header.checksum_a = header.checksum_b = 0;
+
+        inputfile.read(reinterpret_cast<char *>(&f), sizeof(int64_t));
+        if (f == config_flag_encoded) {
+            inputfile.read(reinterpret_cast<char *>(&words), sizeof(int64_t));
+            if (words <= config_encoding_word) {
+                hila::out0 << conferr << "too short header, " << words << " words\n";
+                return false;
+            }
+        } else if (f != config_flag) {
+            hila::out0 << conferr << "wrong id, should be " << config_flag << " is " << f
+                       << '\n';
+            return false;
+        }
+
+        inputfile.read(reinterpret_cast<char *>(&f), sizeof(int64_t));
+        if (f != NDIM) {
+            hila::out0 << conferr << "wrong dimensionality, should be " << NDIM << " is " << f
+                       << '\n';
+            return false;
+        }
+
+        inputfile.read(reinterpret_cast<char *>(&f), sizeof(int64_t));
+        if (f != sizeof(T)) {
+            hila::out0 << conferr << "wrong size of field element, should be " << sizeof(T)
+                       << " is " << f << '\n';
+            return false;
+        }
+
+        foralldir(d) {
             inputfile.read(reinterpret_cast<char *>(&f), sizeof(int64_t));
-            ok = (f == NDIM);
-            if (!ok)
-                hila::out0 << conferr << "wrong dimensionality, should be " << NDIM << " is " << f
+            if (f != lattice.size(d)) {
+                hila::out0 << conferr << "incorrect lattice dimension " << hila::prettyprint(d)
+                           << " is " << f << " should be " << lattice.size(d) << '\n';
+                return false;
+            }
+        }
+
+        if (words > config_encoding_word) {
+            inputfile.read(reinterpret_cast<char *>(&header.encoding), sizeof(int64_t));
+            if (header.encoding < 0 || header.encoding > 3 ||
+                ((header.encoding & hila::config_encoding::compact) &&
+                 !hila::is_SU_matrix<T>::value)) {
+                hila::out0 << conferr << "unknown or unusable link encoding " << header.encoding
                            << '\n';
+                return false;
+            }
         }
 
-        if (ok && hila::myrank() == 0) {
-            inputfile.read(reinterpret_cast<char *>(&f), sizeof(int64_t));
-            ok = (f == sizeof(T));
-            if (!ok)
-                hila::out0 << conferr << "wrong size of field element, should be " << sizeof(T)
-                           << " is " << f << '\n';
+        if (words > config_checksum_word + 1) {
+            int64_t cs[2];
+            inputfile.read(reinterpret_cast<char *>(cs), 2 * sizeof(int64_t));
+            header.has_checksum = true;
+            header.checksum_a = cs[0];
+            header.checksum_b = cs[1];
         }
 
-        if (ok && hila::myrank() == 0) {
+        header.size = words * sizeof(int64_t);
+        if (inputfile.fail()) {
+            hila::out0 << conferr << "error reading header\n";
+            return false;
+        }
+        return true;
+    }
+
+    // Conversion between links and file records of n numbers of type S
+    template <typename S, int n>
+    void encode_links(Direction d, Field<Vector<n, S>> &rec) const {
+        const Field<T> &f = fdir[d];
+        onsites(ALL) {
+            for (int i = 0; i < n; i++)
+                rec[X].e(i) = static_cast<S>(hila::get_number_in_var(f[X], i));
+        }
+    }
 
-            foralldir(d) {
-                inputfile.read(reinterpret_cast<char *>(&f), sizeof(int64_t));
-                ok = ok && (f == lattice.size(d));
-                if (!ok)
-                    hila::out0 << conferr << "incorrect lattice dimension " << hila::prettyprint(d)
-                               << " is " << f << " should be " << lattice.size(d) << '\n';
+    template <typename S, int n>
+    void decode_links(const Field<Vector<n, S>> &rec, Direction d) {
+        Field<T> &f = fdir[d];
+        onsites(ALL) {
+            T u;
+            for (int i = 0; i < n; i++)
+                hila::set_number_in_var(u, i, static_cast<link_scalar>(rec[X].e(i)));
+            if constexpr (hila::is_SU_matrix<T>::value) {
+                // fill in the last row and restore unitarity lost in float rounding
+                if constexpr (n < n_full)
+                    u.reconstruct_last_row();
+                u.reunitarize();
             }
+            f[X] = u;
         }
+    }
 
-        if (!hila::broadcast(ok)) {
-            hila::terminate(1);
+    // Write / read links after the header, with encoding given by S and n,
+    // accumulating the node-local checksum.  Closes the file.
+    template <typename S, int n>
+    void write_config_links(std::ofstream &outputfile, const std::string &filename,
+                            int64_t header_size, hila::site_checksum *checksum) const {
+
+        constexpr bool encoded = (n != n_full || !std::is_same<S, link_scalar>::value);
+        Field<Vector<n, S>> rec;
+#ifdef PARALLEL_IO
+        hila::close_file(filename, outputfile);
+        MPI_File fh;
+        hila::open_mpi_file(filename, fh, true);
+#endif
+        foralldir(d) {
+            if (checksum != nullptr)
+                checksum->index_offset = (int64_t)d * lattice.volume();
+            if constexpr (encoded) {
+                encode_links(d, rec);
+#ifdef PARALLEL_IO
+                rec.write(fh, header_size + (int64_t)d * lattice.volume() * sizeof(Vector<n, S>),
+                          checksum);
+#else
+                rec.write(outputfile, true, 8, checksum);
+#endif
+            } else {
+#ifdef PARALLEL_IO
+                fdir[d].write(fh, header_size + (int64_t)d * lattice.volume() * sizeof(T),
+                              checksum);
+#else
+                fdir[d].write(outputfile, true, 8, checksum);
+#endif
+            }
         }
+#ifdef PARALLEL_IO
+        hila::close_mpi_file(filename, fh);
+#else
+        hila::close_file(filename, outputfile);
+#endif
+    }
 
-        read(inputfile);
+    template <typename S, int n>
+    void read_config_links(std::ifstream &inputfile, const std::string &filename,
+                           int64_t header_size, hila::site_checksum &checksum) {
+
+        constexpr bool encoded = (n != n_full || !std::is_same<S, link_scalar>::value);
+        Field<Vector<n, S>> rec;
+#ifdef PARALLEL_IO
         hila::close_file(filename, inputfile);
+        MPI_File fh;
+        hila::open_mpi_file(filename, fh, false);
+#endif
+        foralldir(d) {
+            checksum.index_offset = (int64_t)d * lattice.volume();
+            if constexpr (encoded) {
+#ifdef PARALLEL_IO
+                rec.read(fh, header_size + (int64_t)d * lattice.volume() * sizeof(Vector<n, S>),
+                         &checksum);
+#else
+                rec.read(inputfile, &checksum);
+#endif
+                decode_links(rec, d);
+            } else {
+#ifdef PARALLEL_IO
+                fdir[d].read(fh, header_size + (int64_t)d * lattice.volume() * sizeof(T),
+                             &checksum);
+#else
+                fdir[d].read(inputfile, &checksum);
+#endif
+            }
+        }
+#ifdef PARALLEL_IO
+        hila::close_mpi_file(filename, fh);
+#else
+        hila::close_file(filename, inputfile);
+#endif
+    }
+
+  public:
+    /// Sharded checkpoint: each rank writes its node block of all directions to
+    /// "filename.shard.<generation>.<rank>", rank 0 writes the manifest "filename".
+    /// See shard_io.h
+    void config_write_sharded(const std::string &filename) const {
+        std::vector<std::vector<T>> local(NDIM);
+        std::vector<const void *> blocks(NDIM);
+        foralldir(d) {
+            fdir[d].copy_local_data(local[d]);
+            blocks[d] = local[d].data();
+        }
+        hila::write_shards(filename, blocks, sizeof(T));
+    }
+
+    /// Asynchronous sharded checkpoint: node-local data is copied to a staging buffer and
+    /// written by a background thread, while the updates continue.  The manifest is
+    /// replaced in hila::wait_checkpoint(), which has to be called before reading
+    void config_write_async(const std::string &filename) const {
+        auto staging = std::make_shared<std::vector<std::vector<T>>>(NDIM);
+        std::vector<const void *> blocks(NDIM);
+        foralldir(d) {
+            fdir[d].copy_local_data((*staging)[d]);
+            blocks[d] = (*staging)[d].data();
+        }
+        hila::write_shards_async(filename, blocks, sizeof(T), staging);
+    }
+
+    /// Read a sharded checkpoint, also when written with different node layout
+    void config_read_sharded(const std::string &filename) {
+        std::vector<std::vector<T>> local(NDIM);
+        std::vector<void *> blocks(NDIM);
+        foralldir(d) {
+            local[d].resize(lattice.mynode.volume());
+            blocks[d] = local[d].data();
+        }
+        hila::read_shards(filename, blocks, sizeof(T));
+        foralldir(d) {
+            fdir[d].set_local_data(local[d]);
+        }
+    }
+
+    /// Write the configuration in ILDG format (LIME file), precision 64 or 32 bits.
+    /// Optional lfn is the logical file name record.  The links are streamed with
+    /// collective MPI-IO, see lime_io.h
+    void config_write_ildg(const std::string &filename, int precision = 64,
+                           const std::string &lfn = "") const {
+
+        check_ildg_type();
+        if (precision != 32 && precision != 64) {
+            hila::out0 << "ILDG ERROR: precision must be 32 or 64, not " << precision << '\n';
+            hila::terminate(1);
+        }
+
+        int64_t data_bytes = lattice.volume() * NDIM * n_full * (precision / 8);
+        int64_t offset = hila::write_ildg_start(filename, T::rows(), precision, data_bytes);
+
+        hila::site_checksum checksum;
+        MPI_File fh;
+        hila::open_mpi_file(filename, fh, true);
+        if (precision == 64)
+            write_ildg_links<double>(fh, offset, checksum);
+        else
+            write_ildg_links<float>(fh, offset, checksum);
+        hila::close_mpi_file(filename, fh);
+
+        checksum.reduce();
+        hila::write_ildg_end(filename, offset, data_bytes, checksum, lfn);
+    }
+
+    /// Read ILDG format configuration, with either precision.  The SciDAC checksum
+    /// is verified if the file has one
+    void config_read_ildg(const std::string &filename) {
+
+        check_ildg_type();
+        hila::ildg_info info;
+        if (!hila::read_ildg_info(filename, info))
+            hila::terminate(1);
+
+        std::string err("ILDG ERROR in file " + filename + ": ");
+        if (info.ncolor != T::rows()) {
+            hila::out0 << err << "field is su" << info.ncolor << "gauge, expecting su"
+                       << T::rows() << "gauge\n";
+            hila::terminate(1);
+        }
+        foralldir(d) {
+            if (info.size[d] != lattice.size(d)) {
+                hila::out0 << err << "incorrect lattice dimension " << hila::prettyprint(d)
+                           << " is " << info.size[d] << " should be " << lattice.size(d)
+                           << '\n';
+                hila::terminate(1);
+            }
+        }
+        if (info.data_bytes != lattice.volume() * NDIM * n_full * (info.precision / 8)) {
+            hila::out0 << err << "wrong size of binary data, " << info.data_bytes
+                       << " bytes\n";
+            hila::terminate(1);
+        }
+
+        hila::site_checksum checksum;
+        MPI_File fh;
+        hila::open_mpi_file(filename, fh, false);
+        if (info.precision == 64)
+            read_ildg_links<double>(fh, info.data_offset, checksum);
+        else
+            read_ildg_links<float>(fh, info.data_offset, checksum);
+        hila::close_mpi_file(filename, fh);
+
+        if (info.has_checksum) {
+            checksum.reduce();
+            if (checksum.a != info.checksum_a || checksum.b != info.checksum_b) {
+                hila::out0 << err << "checksum mismatch, " << std::hex << "file "
+                           << info.checksum_a << ' ' << info.checksum_b << ", data "
+                           << checksum.a << ' ' << checksum.b << std::dec << '\n';
+                hila::terminate(1);
+            }
+        }
+
+        // single precision links are not quite unitary
+        if constexpr (hila::is_SU_matrix<T>::value) {
+            if (info.precision == 32) {
+                foralldir(d) {
+                    Field<T> &f = fdir[d];
+                    onsites(ALL) f[X].reunitarize();
+                }
+            }
+        }
+    }
+
+  private:
+    // ILDG stores complex NxN matrices
+    static void check_ildg_type() {
+        static_assert(hila::contains_complex<T>::value && T::rows() == T::columns(),
+                      "ILDG files need complex square matrix gauge fields");
+    }
+
+    // ILDG site record: links of all directions, as numbers of type S.
+    // Local node data is reordered to site records on the host, so that only
+    // node-local buffers are needed
+    template <typename S>
+    void write_ildg_links(MPI_File fh, int64_t offset, hila::site_checksum &checksum) const {
+        const size_t nsites = lattice.mynode.volume();
+        std::vector<S> site_data(nsites * NDIM * n_full);
+        std::vector<T> local;
+        foralldir(d) {
+            fdir[d].copy_local_data(local);
+            const link_scalar *p = reinterpret_cast<const link_scalar *>(local.data());
+            for (size_t i = 0; i < nsites; i++)
+                for (int k = 0; k < n_full; k++)
+                    site_data[(i * NDIM + d) * n_full + k] = static_cast<S>(p[i * n_full + k]);
+        }
+        hila::write_ildg_data(fh, offset, site_data.data(), NDIM * n_full * sizeof(S),
+                              sizeof(S), checksum);
+    }
+
+    template <typename S>
+    void read_ildg_links(MPI_File fh, int64_t offset, hila::site_checksum &checksum) {
+        const size_t nsites = lattice.mynode.volume();
+        std::vector<S> site_data(nsites * NDIM * n_full);
+        hila::read_ildg_data(fh, offset, site_data.data(), NDIM * n_full * sizeof(S), sizeof(S),
+                             checksum);
+        std::vector<T> local(nsites);
+        foralldir(d) {
+            link_scalar *p = reinterpret_cast<link_scalar *>(local.data());
+            for (size_t i = 0; i < nsites; i++)
+                for (int k = 0; k < n_full; k++)
+                    p[i * n_full + k] =
+                        static_cast<link_scalar>(site_data[(i * NDIM + d) * n_full + k]);
+            fdir[d].set_local_data(local);
+        }
     }
 };
 
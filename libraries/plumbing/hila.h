@@ -27,6 +27,7 @@
 //#endif
 
 #include "plumbing/gaugefield.h"
+#include "plumbing/gather_batch.h"
 #include "plumbing/input.h"
 #include "plumbing/fft.h"
 
@@ -37,5 +38,6 @@
 #endif
 
 #include "plumbing/random.h"
+#include "plumbing/site_random.h"
 
 #endif
\ No newline at end of file
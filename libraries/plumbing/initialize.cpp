@@ -373,6 +373,8 @@ void hila::terminate(int status) {
     hila::timestamp("Terminate");
     print_dashed_line();
     hila::about_to_finish = true; // avoid destructors
+    // a background checkpoint write is abandoned, the thread has to be joined
+    hila::join_checkpoint_writer();
     if (is_comm_initialized()) {
         finish_communications();
     }
@@ -397,6 +399,9 @@ void hila::error(const std::string &msg) {
  * Prints timing information and information about communications
  */
 void hila::finishrun() {
+    // complete a possible background checkpoint write
+    hila::wait_checkpoint();
+
     report_timers();
 
     for (const lattice_struct *latp : lattices) {
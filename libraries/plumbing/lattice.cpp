@@ -1,4 +1,5 @@
 
+#include <algorithm>
 #include "plumbing/defs.h"
 #include "plumbing/lattice.h"
 #include "plumbing/field.h"
@@ -47,6 +48,10 @@ void lattice_struct::setup(const CoordinateVector &siz) {
 
     setup_nodes();
 
+#ifdef SHARED_MEMORY_HALO
+    hila::setup_shared_halo();
+#endif
+
     // set up the comm arrays
     create_std_gathers();
 
@@ -609,9 +614,36 @@ void lattice_struct::initialize_wait_arrays() {
                 wait_arr_[i] = wait_arr_[i] | (1 << odir);
         }
     }
+
+    // interior and boundary site lists for wait_site_list(), even sites first
+    for (int b = 0; b < 2; b++) {
+        wait_sites_[b].clear();
+        for (Parity par : {EVEN, ODD}) {
+            for (unsigned i = 0; i < mynode.sites; i++) {
+                if (site_parity(i) == par && (wait_arr_[i] != 0) == (b == 1))
+                    wait_sites_[b].push_back(i);
+            }
+            if (par == EVEN)
+                wait_sites_even_[b] = wait_sites_[b].size();
+        }
+        wait_sites_[b].shrink_to_fit();
+    }
 }
 
 
+/////////////////////////////////////////////////////////////////////
+/// Interior and boundary site lists, see lattice.h
+
+lattice_struct::site_list lattice_struct::wait_site_list(Parity par, bool boundary) const {
+    const std::vector<unsigned> &l = wait_sites_[boundary ? 1 : 0];
+    unsigned n_even = wait_sites_even_[boundary ? 1 : 0];
+    if (par == EVEN)
+        return {l.data(), n_even};
+    if (par == ODD)
+        return {l.data() + n_even, (unsigned)l.size() - n_even};
+    return {l.data(), (unsigned)l.size()};
+}
+
 #ifdef SPECIAL_BOUNDARY_CONDITIONS
 
 /////////////////////////////////////////////////////////////////////
@@ -738,8 +770,6 @@ void lattice_struct::setup_special_boundary_array(Direction d) {
 /// TODO: implement some other neighbour schemas!
 /////////////////////////////////////////////////////////////////////
 
-#if 0
-
 /// This is a helper routine, returning a vector of comm_node_structs for all nodes
 /// involved with communication.
 /// If receive == true, this is "receive" end and index will be filled.
@@ -831,11 +861,14 @@ lattice_struct::create_comm_node_vector(CoordinateVector offset, unsigned *index
     // ci.receive_buf_size = c_buffer;  // total buf size
 
     // we'll reuse np_even and np_odd as counting arrays below
-    for (int i = 0; i < nnodes; i++)
+    for (unsigned i = 0; i < nnodes; i++)
         np_even[i] = np_odd[i] = 0;
 
     if (!receive) {
-        // sending end -- create sitelists
+        // sending end -- create sitelists.  The receiver fills its buffer in its own
+        // site order, which is not the order of the sites here if the offset wraps
+        // around the lattice.  Thus order the sites by the site index on the receiver
+        std::vector<std::vector<std::pair<unsigned, unsigned>>> order(nnodes);
 
         for (unsigned i = 0; i < mynode.sites; i++) {
             CoordinateVector ln, l;
@@ -848,16 +881,24 @@ lattice_struct::create_comm_node_vector(CoordinateVector offset, unsigned *index
                 // find the node from the list
                 while (node_v[n].rank != r)
                     n++;
+                order[n].push_back({site_index(ln, r), i});
+            }
+        }
+
+        for (unsigned n = 0; n < nnodes; n++) {
+            std::sort(order[n].begin(), order[n].end());
+            for (auto &o : order[n]) {
                 // we'll fill the buffers according to the parity of receieving node
                 // first even, then odd sites in the buffer
                 unsigned k;
+                CoordinateVector ln = (coordinates(o.second) + offset).mod(size());
                 if (ln.parity() == EVEN)
                     k = np_even[n]++;
                 else
                     k = node_v[n].evensites + np_odd[n]++;
 
                 // and set the ptr to the site to be communicated
-                node_v[n].sitelist[k] = i;
+                node_v[n].sitelist[k] = o.second;
             }
         }
 
@@ -867,17 +908,19 @@ lattice_struct::create_comm_node_vector(CoordinateVector offset, unsigned *index
 
         for (unsigned i = 0; i < mynode.sites; i++) {
             if (index[i] >= mynode.sites) {
-                int r = index[i] - mynode.sites;
+                unsigned r = index[i] - mynode.sites;
                 int n = 0;
                 // find the node which sends this
                 while (node_v[n].rank != r)
                     n++;
 
+                // keep the remote sites distinguishable from the local ones
                 CoordinateVector l = coordinates(i);
                 if (l.parity() == EVEN)
-                    index[i] = node_v[n].buffer + (np_even[n]++);
+                    index[i] = mynode.sites + node_v[n].buffer + (np_even[n]++);
                 else
-                    index[i] = node_v[n].buffer + node_v[n].evensites + (np_odd[n]++);
+                    index[i] =
+                        mynode.sites + node_v[n].buffer + node_v[n].evensites + (np_odd[n]++);
             }
         }
     }
@@ -900,10 +943,91 @@ lattice_struct::create_general_gather(const CoordinateVector &offset) {
     ci.to_node = create_comm_node_vector(offset, nullptr, false); // create sending end
 
     // set the total receive buffer size from the last vector
-    const comm_node_struct &r = ci.from_node[ci.from_node.size() - 1];
-    ci.receive_buf_size = r.buffer + r.sites;
+    if (ci.from_node.size() > 0) {
+        const comm_node_struct &r = ci.from_node[ci.from_node.size() - 1];
+        ci.receive_buf_size = r.buffer + r.sites;
+    } else {
+        ci.receive_buf_size = 0;
+    }
+
+    // site lists by parity.  Receive buffer position -> site
+    std::vector<unsigned> remote(ci.receive_buf_size);
+    for (Parity par : {EVEN, ODD}) {
+        int p = static_cast<int>(par) - 1;
+        for (unsigned i = loop_begin(par); i < loop_end(par); i++) {
+            if (ci.index[i] < mynode.sites) {
+                ci.local_sites[p].push_back(i);
+                ci.local_source[p].push_back(ci.index[i]);
+            } else {
+                remote[ci.index[i] - mynode.sites] = i;
+            }
+        }
+    }
+
+    int pa = static_cast<int>(ALL) - 1;
+    for (Parity par : {EVEN, ODD}) {
+        int p = static_cast<int>(par) - 1;
+        for (auto &fn : ci.from_node) {
+            size_t start = fn.buffer + (par == ODD ? fn.evensites : 0);
+            ci.remote_sites[p].insert(ci.remote_sites[p].end(), remote.begin() + start,
+                                      remote.begin() + start + fn.n_sites(par));
+        }
+        ci.local_sites[pa].insert(ci.local_sites[pa].end(), ci.local_sites[p].begin(),
+                                  ci.local_sites[p].end());
+        ci.local_source[pa].insert(ci.local_source[pa].end(), ci.local_source[p].begin(),
+                                   ci.local_source[p].end());
+    }
+    // with parity ALL the messages contain even and odd sites of each node
+    ci.remote_sites[pa] = remote;
 
     return ci;
 }
 
-#endif
+int64_t lattice_struct::offset_index(const CoordinateVector &offset) const {
+    CoordinateVector m = offset.mod(size());
+    int64_t index = 0;
+    for (int d = NDIM - 1; d >= 0; d--)
+        index = index * size(d) + m[d];
+    return index;
+}
+
+const lattice_struct::gen_comminfo_struct &
+lattice_struct::get_general_gather(const CoordinateVector &offset) {
+
+    CoordinateVector m = offset.mod(size());
+    int64_t key = offset_index(m);
+
+    for (auto it = gen_comminfo_cache_.begin(); it != gen_comminfo_cache_.end(); ++it) {
+        if (it->first == key) {
+            gen_comminfo_cache_.splice(gen_comminfo_cache_.begin(), gen_comminfo_cache_, it);
+            return it->second;
+        }
+    }
+
+    // all ranks create and drop the same gathers, dropping needs no communication
+    if (gen_comminfo_cache_.size() >= GEN_GATHER_CACHE_SIZE) {
+        free_general_gather(gen_comminfo_cache_.back().second);
+        gen_comminfo_cache_.pop_back();
+    }
+    gen_comminfo_cache_.emplace_front(key, create_general_gather(m));
+    return gen_comminfo_cache_.front().second;
+}
+
+void lattice_struct::free_general_gather(gen_comminfo_struct &ci) {
+    std::free(ci.index);
+    ci.index = nullptr;
+    for (auto *nodes : {&ci.from_node, &ci.to_node}) {
+        for (auto &n : *nodes) {
+            if (n.sitelist != nullptr)
+                std::free(n.sitelist);
+        }
+        nodes->clear();
+    }
+}
+
+lattice_struct::~lattice_struct() {
+    for (auto &g : gen_comminfo_cache_)
+        free_general_gather(g.second);
+}
+
+
@@ -6,6 +6,8 @@
 #include <fstream>
 #include <array>
 #include <vector>
+#include <map>
+#include <list>
 
 // SUBNODE_LAYOUT is now defined in main.mk
 // #define SUBNODE_LAYOUT
@@ -188,12 +190,18 @@ class lattice_struct {
         unsigned receive_buf_size; // only for general gathers
     };
 
-    /// general communication
+    /// general communication.  index[i] is the site index of i + offset if it is on
+    /// this node, otherwise mynode.sites + position in the receive buffer
     struct gen_comminfo_struct {
         unsigned *index;
         std::vector<comm_node_struct> from_node;
         std::vector<comm_node_struct> to_node;
         size_t receive_buf_size;
+
+        /// Site lists by parity (index static_cast<int>(par) - 1): sites i with
+        /// i + offset on this node, the site indices of i + offset, and sites which get
+        /// the data from the receive messages, in the order of the messages
+        std::array<std::vector<unsigned>, 3> local_sites, local_source, remote_sites;
     };
 
     /// nearest neighbour comminfo struct
@@ -223,6 +231,8 @@ class lattice_struct {
     backend_lattice_struct *backend_lattice;
 #endif
 
+    ~lattice_struct();
+
     void setup(const CoordinateVector &siz);
     void setup_layout();
     void setup_nodes();
@@ -264,6 +274,11 @@ class lattice_struct {
 
     void create_std_gathers();
     gen_comminfo_struct create_general_gather(const CoordinateVector &r);
+    /// index of offset r modulo lattice size, same for periodically equivalent offsets
+    int64_t offset_index(const CoordinateVector &r) const;
+    /// cached general gather for offset r, created on first use.  Collective on first use.
+    /// The reference is valid until the next call
+    const gen_comminfo_struct &get_general_gather(const CoordinateVector &r);
     std::vector<comm_node_struct> create_comm_node_vector(CoordinateVector offset, unsigned *index,
                                                           bool receive);
 
@@ -366,6 +381,40 @@ class lattice_struct {
     /* MPI functions and variables. Define here in lattice? */
     void initialize_wait_arrays();
 
+    /// Contiguous list of site indices, returned by wait_site_list()
+    struct site_list {
+        const unsigned *sites;
+        unsigned n;
+        const unsigned *data() const {
+            return sites;
+        }
+        unsigned size() const {
+            return n;
+        }
+    };
+
+    /// Sites of parity par which need halo data from some other node (boundary == true)
+    /// or which do not (boundary == false).  With hilapp -wait-site-lists, onsites() loops
+    /// go through these lists while communicating, first the interior and after waiting the
+    /// boundary.  The lists are built in lattice setup.  They do not depend on the directions
+    /// of the gathers: lists for all direction masks would take too much memory
+    site_list wait_site_list(Parity par, bool boundary) const;
+
+  private:
+    /// interior [0] and boundary [1] sites, even sites first, and the number of even
+    /// sites in each
+    std::vector<unsigned> wait_sites_[2];
+    unsigned wait_sites_even_[2];
+
+    /// general gathers created by get_general_gather(), key is offset_index().
+    /// Most recently used first, at most GEN_GATHER_CACHE_SIZE entries
+    std::list<std::pair<int64_t, gen_comminfo_struct>> gen_comminfo_cache_;
+
+    /// release the memalloc'd arrays of a general gather
+    static void free_general_gather(gen_comminfo_struct &ci);
+
+  public:
+
 
     MPI_Comm mpi_comm_lat;
 
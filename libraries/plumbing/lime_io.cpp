@@ -0,0 +1,315 @@
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+#include "plumbing/defs.h"
+#include "plumbing/lattice.h"
+#include "plumbing/com_mpi.h"
+#include "plumbing/lime_io.h"
+
+//////////////////////////////////////////////////////////////////
+/// LIME and ILDG file I/O - see lime_io.h
+//////////////////////////////////////////////////////////////////
+
+#define LIME_MAGIC 0x456789ab
+#define LIME_VERSION 1
+#define LIME_HEADER_BYTES 144
+#define LIME_TYPE_BYTES 128
+#define LIME_MB_FLAG 0x8000
+#define LIME_ME_FLAG 0x4000
+
+namespace hila {
+
+static bool is_little_endian() {
+    const uint16_t one = 1;
+    return *reinterpret_cast<const unsigned char *>(&one) == 1;
+}
+
+// reverse the bytes of n items of given size, in place
+static void swap_bytes(void *data, size_t n, size_t size) {
+    unsigned char *p = static_cast<unsigned char *>(data);
+#ifdef OPENMP
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < n; i++) {
+        std::reverse(p + i * size, p + (i + 1) * size);
+    }
+}
+
+// big-endian integers in the LIME header
+template <typename T>
+static void put_big_endian(unsigned char *p, T v) {
+    for (int i = sizeof(T) - 1; i >= 0; i--) {
+        p[i] = v & 0xff;
+        v >>= 8;
+    }
+}
+
+template <typename T>
+static T get_big_endian(const unsigned char *p) {
+    T v = 0;
+    for (size_t i = 0; i < sizeof(T); i++)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+static int64_t lime_padding(int64_t bytes) {
+    return (8 - bytes % 8) % 8;
+}
+
+/////////////////////////////////////////////////////////////////
+/// LIME records
+
+bool write_lime_header(std::ostream &out, const std::string &type, int64_t bytes, bool mb,
+                       bool me) {
+
+    unsigned char h[LIME_HEADER_BYTES] = {0};
+    put_big_endian<uint32_t>(h, LIME_MAGIC);
+    put_big_endian<uint16_t>(h + 4, LIME_VERSION);
+    put_big_endian<uint16_t>(h + 6, (mb ? LIME_MB_FLAG : 0) | (me ? LIME_ME_FLAG : 0));
+    put_big_endian<uint64_t>(h + 8, bytes);
+    std::strncpy(reinterpret_cast<char *>(h + 16), type.c_str(), LIME_TYPE_BYTES - 1);
+
+    out.write(reinterpret_cast<char *>(h), LIME_HEADER_BYTES);
+    return !out.fail();
+}
+
+bool write_lime_record(std::ostream &out, const std::string &type, const std::string &payload,
+                       bool mb, bool me) {
+
+    const char pad[8] = {0};
+    write_lime_header(out, type, payload.size(), mb, me);
+    out.write(payload.data(), payload.size());
+    out.write(pad, lime_padding(payload.size()));
+    return !out.fail();
+}
+
+bool read_lime_records(std::istream &in, std::vector<lime_record> &records) {
+
+    records.clear();
+    unsigned char h[LIME_HEADER_BYTES];
+    while (in.read(reinterpret_cast<char *>(h), LIME_HEADER_BYTES)) {
+        if (get_big_endian<uint32_t>(h) != LIME_MAGIC)
+            return false;
+
+        lime_record rec;
+        rec.bytes = get_big_endian<uint64_t>(h + 8);
+        rec.offset = in.tellg();
+        h[16 + LIME_TYPE_BYTES - 1] = 0;
+        rec.type = reinterpret_cast<char *>(h + 16);
+        records.push_back(rec);
+
+        in.seekg(rec.offset + rec.bytes + lime_padding(rec.bytes));
+    }
+    return !records.empty();
+}
+
+bool is_lime_file(const std::string &filename) {
+
+    bool ok = false;
+    if (hila::myrank() == 0) {
+        std::ifstream in(filename, std::ios::in | std::ios::binary);
+        unsigned char h[4];
+        if (in.read(reinterpret_cast<char *>(h), 4))
+            ok = (get_big_endian<uint32_t>(h) == LIME_MAGIC);
+    }
+    return hila::broadcast(ok);
+}
+
+/////////////////////////////////////////////////////////////////
+/// ILDG records.  The XML content is simple enough that we just look for the tags
+
+static bool xml_value(const std::string &xml, const std::string &tag, std::string &value) {
+    size_t b = xml.find("<" + tag + ">");
+    if (b == std::string::npos)
+        return false;
+    b += tag.size() + 2;
+    size_t e = xml.find("</" + tag + ">", b);
+    if (e == std::string::npos)
+        return false;
+    value = xml.substr(b, e - b);
+    return true;
+}
+
+static const char *ildg_size_tags[4] = {"lx", "ly", "lz", "lt"};
+
+static std::string ildg_format_xml(int ncolor, int precision) {
+    std::stringstream s;
+    s << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      << "<ildgFormat xmlns=\"http://www.lqcd.org/ildg\"\n"
+      << "            xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\"\n"
+      << "            xsi:schemaLocation=\"http://www.lqcd.org/ildg "
+         "http://www.lqcd.org/ildg/filefmt.xsd\">\n"
+      << "  <version>1.0</version>\n"
+      << "  <field>su" << ncolor << "gauge</field>\n"
+      << "  <precision>" << precision << "</precision>\n";
+    for (int d = 0; d < NDIM; d++)
+        s << "  <" << ildg_size_tags[d] << ">" << lattice.size(d) << "</"
+          << ildg_size_tags[d] << ">\n";
+    s << "</ildgFormat>\n";
+    return s.str();
+}
+
+static std::string scidac_checksum_xml(const site_checksum &checksum) {
+    std::stringstream s;
+    s << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+      << "<scidacChecksum><version>1.0</version>" << std::hex << "<suma>" << checksum.a
+      << "</suma><sumb>" << checksum.b << "</sumb></scidacChecksum>";
+    return s.str();
+}
+
+static std::string read_payload(std::istream &in, const lime_record &rec) {
+    std::string s(rec.bytes, '\0');
+    in.seekg(rec.offset);
+    in.read(&s[0], rec.bytes);
+    return s;
+}
+
+// read the ILDG records on rank 0
+static bool parse_ildg_file(const std::string &filename, ildg_info &info) {
+
+    std::string err("ILDG ERROR in file " + filename + ": ");
+
+    std::ifstream in(filename, std::ios::in | std::ios::binary);
+    std::vector<lime_record> records;
+    if (in.fail() || !read_lime_records(in, records)) {
+        hila::out0 << err << "not a LIME file\n";
+        return false;
+    }
+    in.clear();
+
+    bool has_format = false, has_data = false;
+    info.has_checksum = false;
+    for (auto &rec : records) {
+        if (rec.type == "ildg-format") {
+            std::string xml = read_payload(in, rec), v;
+            if (!xml_value(xml, "field", v) ||
+                std::sscanf(v.c_str(), "su%dgauge", &info.ncolor) != 1) {
+                hila::out0 << err << "unknown field type in ildg-format\n";
+                return false;
+            }
+            if (!xml_value(xml, "precision", v) ||
+                ((info.precision = std::stoi(v)) != 32 && info.precision != 64)) {
+                hila::out0 << err << "unknown precision in ildg-format\n";
+                return false;
+            }
+            for (int d = 0; d < NDIM; d++) {
+                if (!xml_value(xml, ildg_size_tags[d], v)) {
+                    hila::out0 << err << "lattice size missing in ildg-format\n";
+                    return false;
+                }
+                info.size[d] = std::stoll(v);
+            }
+            has_format = true;
+        } else if (rec.type == "ildg-binary-data") {
+            info.data_offset = rec.offset;
+            info.data_bytes = rec.bytes;
+            has_data = true;
+        } else if (rec.type == "scidac-checksum") {
+            std::string xml = read_payload(in, rec), a, b;
+            if (xml_value(xml, "suma", a) && xml_value(xml, "sumb", b)) {
+                info.checksum_a = std::stoul(a, nullptr, 16);
+                info.checksum_b = std::stoul(b, nullptr, 16);
+                info.has_checksum = true;
+            }
+        }
+    }
+
+    if (!has_format || !has_data) {
+        hila::out0 << err << "ildg-format or ildg-binary-data record missing\n";
+        return false;
+    }
+    if (in.fail()) {
+        hila::out0 << err << "error reading records\n";
+        return false;
+    }
+    return true;
+}
+
+bool read_ildg_info(const std::string &filename, ildg_info &info) {
+
+    if (NDIM != 4) {
+        hila::out0 << "ILDG ERROR: ILDG files are defined only for 4 dimensions\n";
+        return false;
+    }
+
+    bool ok = true;
+    if (hila::myrank() == 0)
+        ok = parse_ildg_file(filename, info);
+
+    if (!hila::broadcast(ok))
+        return false;
+    hila::broadcast(info);
+    return true;
+}
+
+int64_t write_ildg_start(const std::string &filename, int ncolor, int precision,
+                         int64_t data_bytes) {
+
+    if (NDIM != 4) {
+        hila::out0 << "ILDG ERROR: ILDG files are defined only for 4 dimensions\n";
+        hila::terminate(1);
+    }
+
+    int64_t offset = 0;
+    bool ok = true;
+    if (hila::myrank() == 0) {
+        std::ofstream out(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+        write_lime_record(out, "ildg-format", ildg_format_xml(ncolor, precision), true, false);
+        write_lime_header(out, "ildg-binary-data", data_bytes, false, false);
+        offset = out.tellp();
+        out.close();
+        ok = !out.fail();
+    }
+    if (!hila::broadcast(ok)) {
+        hila::out0 << "ERROR in writing file " << filename << '\n';
+        hila::terminate(4);
+    }
+    return hila::broadcast(offset);
+}
+
+void write_ildg_end(const std::string &filename, int64_t data_offset, int64_t data_bytes,
+                    const site_checksum &checksum, const std::string &lfn) {
+
+    bool ok = true;
+    if (hila::myrank() == 0) {
+        const char pad[8] = {0};
+        std::fstream out(filename, std::ios::in | std::ios::out | std::ios::binary);
+        out.seekp(data_offset + data_bytes);
+        out.write(pad, lime_padding(data_bytes));
+        write_lime_record(out, "scidac-checksum", scidac_checksum_xml(checksum), false,
+                          lfn.empty());
+        if (!lfn.empty())
+            write_lime_record(out, "ildg-data-lfn", lfn, false, true);
+        out.close();
+        ok = !out.fail();
+    }
+    if (!hila::broadcast(ok)) {
+        hila::out0 << "ERROR in writing file " << filename << '\n';
+        hila::terminate(4);
+    }
+}
+
+void write_ildg_data(MPI_File fh, int64_t offset, void *buffer, size_t site_bytes,
+                     size_t scalar_size, site_checksum &checksum) {
+
+    size_t n = lattice.mynode.volume() * site_bytes / scalar_size;
+    if (is_little_endian())
+        swap_bytes(buffer, n, scalar_size);
+    checksum.add_node_block(buffer, site_bytes);
+    hila::write_node_block(fh, offset, buffer, site_bytes);
+}
+
+void read_ildg_data(MPI_File fh, int64_t offset, void *buffer, size_t site_bytes,
+                    size_t scalar_size, site_checksum &checksum) {
+
+    size_t n = lattice.mynode.volume() * site_bytes / scalar_size;
+    hila::read_node_block(fh, offset, buffer, site_bytes);
+    checksum.add_node_block(buffer, site_bytes);
+    if (is_little_endian())
+        swap_bytes(buffer, n, scalar_size);
+}
+
+} // namespace hila
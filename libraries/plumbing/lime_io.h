@@ -0,0 +1,87 @@
+#ifndef LIME_IO_H_
+#define LIME_IO_H_
+
+//////////////////////////////////////////////////////////////////////
+/// LIME container and ILDG gauge configuration I/O.
+///
+/// A LIME file is a sequence of records, each with a 144 byte big-endian header
+/// (magic number, version, message begin/end flags, payload length and type string)
+/// followed by the payload padded to a multiple of 8 bytes.
+///
+/// ILDG gauge configurations use the records
+///    "ildg-format"       XML: field type, precision (32/64) and lattice size
+///    "ildg-binary-data"  links, t slowest and x fastest, at each site the links
+///                        x,y,z,t as row-major complex matrices, big-endian
+///    "scidac-checksum"   XML: SciDAC checksums suma, sumb (see checksum.h)
+///    "ildg-data-lfn"     optional logical file name
+///
+/// Only the small records are handled by rank 0.  The binary data is streamed with
+/// collective MPI-IO, each rank accessing only the sites of its own node block, so
+/// that no rank needs a buffer larger than its local volume.
+/// GaugeField::config_write_ildg() and config_read_ildg() use these.
+
+#include "plumbing/defs.h"
+#include "plumbing/checksum.h"
+
+namespace hila {
+
+/// LIME record type and the location of its payload in the file
+struct lime_record {
+    std::string type;
+    int64_t offset; ///< position of the payload
+    int64_t bytes;  ///< payload length without padding
+};
+
+/// Write LIME record header of a payload of length bytes.  MB and ME are the
+/// message begin and end flags.  Returns false on error
+bool write_lime_header(std::ostream &out, const std::string &type, int64_t bytes, bool mb,
+                       bool me);
+
+/// Write complete LIME record, with padding
+bool write_lime_record(std::ostream &out, const std::string &type, const std::string &payload,
+                       bool mb, bool me);
+
+/// Read the list of records of a LIME file, stream positioned at the beginning.
+/// Returns false if the file is not a valid LIME file.  Not collective
+bool read_lime_records(std::istream &in, std::vector<lime_record> &records);
+
+/// Return true if the file starts with a LIME record header
+bool is_lime_file(const std::string &filename);
+
+/// Content of the ILDG records of a configuration file
+struct ildg_info {
+    int ncolor;          ///< N of the "suNgauge" field
+    int precision;       ///< 32 or 64
+    int64_t size[NDIM];  ///< lattice size
+    int64_t data_offset; ///< position of the binary data
+    int64_t data_bytes;
+    bool has_checksum;
+    uint32_t checksum_a, checksum_b;
+};
+
+/// Read and check the ILDG records of file: rank 0 reads, result broadcast.
+/// Returns false on error.  Collective
+bool read_ildg_info(const std::string &filename, ildg_info &info);
+
+/// Start writing an ILDG file: rank 0 writes the format record and the header of the
+/// binary data record.  Returns the position of the binary data. Collective
+int64_t write_ildg_start(const std::string &filename, int ncolor, int precision,
+                         int64_t data_bytes);
+
+/// Finish an ILDG file: rank 0 appends the data padding, checksum record and the
+/// logical file name record (if lfn is non-empty).  Collective
+void write_ildg_end(const std::string &filename, int64_t data_offset, int64_t data_bytes,
+                    const site_checksum &checksum, const std::string &lfn);
+
+/// Write / read the node-local ILDG site records in buffer, ordered as in
+/// Field::copy_local_data(), site_bytes per site and scalars of scalar_size bytes.
+/// Conversion to/from big-endian is done in place, checksum is accumulated for
+/// the data in file byte order.  Collective
+void write_ildg_data(MPI_File fh, int64_t offset, void *buffer, size_t site_bytes,
+                     size_t scalar_size, site_checksum &checksum);
+void read_ildg_data(MPI_File fh, int64_t offset, void *buffer, size_t site_bytes,
+                    size_t scalar_size, site_checksum &checksum);
+
+} // namespace hila
+
+#endif
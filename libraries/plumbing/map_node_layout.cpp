@@ -12,6 +12,9 @@
 /// lattice_struct::node_rank in
 
 
+#include <algorithm>
+#include <map>
+
 #include "plumbing/defs.h"
 #include "plumbing/lattice.h"
 
@@ -36,6 +39,161 @@ unsigned lattice_struct::allnodes::inverse_remap(unsigned i) const {
 }
 
 
+#elif defined(NODE_LAYOUT_TOPOLOGY)
+
+////////////////////////////////////////////////////////////////////
+// Arrange the nodes according to the actual placement of the MPI ranks:
+// the ranks sharing a host (found with MPI_Comm_split_type) are given a block of
+// the node grid.  The shape of the block is chosen to minimize the surface between
+// hosts, i.e. the off-host halo traffic.
+//
+// All hosts must have the same number of ranks, and the number must fit the
+// node grid.  Otherwise the order is left unmodified.
+////////////////////////////////////////////////////////////////////
+
+// Host-to-host surface (in sites) of a host block of blocksize nodes
+static int64_t host_block_surface(const CoordinateVector &blocksize) {
+    int64_t surface = 0;
+    foralldir(d) {
+        // no cut if the block spans the whole direction
+        if (blocksize[d] == lattice.nodes.n_divisions[d])
+            continue;
+        int64_t area = 1;
+        foralldir(d2) {
+            if (d2 != d)
+                area *= (int64_t)blocksize[d2] * lattice.size(d2) / lattice.nodes.n_divisions[d2];
+        }
+        surface += 2 * area;
+    }
+    return surface;
+}
+
+// Find the block with product nblock and minimal surface, dividing the node grid.
+// Returns false if there is none
+static bool best_host_block(int d, int nblock, CoordinateVector &blocksize,
+                            CoordinateVector &best, int64_t &best_surface) {
+    if (d == NDIM) {
+        if (nblock != 1)
+            return false;
+        int64_t s = host_block_surface(blocksize);
+        if (best_surface < 0 || s < best_surface) {
+            best_surface = s;
+            best = blocksize;
+        }
+        return true;
+    }
+
+    bool found = false;
+    for (int b = 1; b <= lattice.nodes.n_divisions[d]; b++) {
+        if (nblock % b == 0 && lattice.nodes.n_divisions[d] % b == 0) {
+            blocksize[d] = b;
+            found |= best_host_block(d + 1, nblock / b, blocksize, best, best_surface);
+        }
+    }
+    return found;
+}
+
+void lattice_struct::allnodes::create_remap() {
+
+    lattice.nodes.map_array = nullptr;
+    lattice.nodes.map_inverse = nullptr;
+
+    if (hila::check_input) {
+        hila::out0 << "Node remapping: NODE_LAYOUT_TOPOLOGY, not available in input check\n";
+        return;
+    }
+
+    // host id of each rank: the lowest lattice rank on the same host
+    MPI_Comm host_comm;
+    MPI_Comm_split_type(lattice.mpi_comm_lat, MPI_COMM_TYPE_SHARED, hila::myrank(),
+                        MPI_INFO_NULL, &host_comm);
+    int host_id = hila::myrank();
+    MPI_Bcast(&host_id, 1, MPI_INT, 0, host_comm);
+    MPI_Comm_free(&host_comm);
+
+    std::vector<int> host_of(lattice.nodes.number);
+    MPI_Allgather(&host_id, 1, MPI_INT, host_of.data(), 1, MPI_INT, lattice.mpi_comm_lat);
+
+    // ranks of each host, in rank order
+    std::map<int, std::vector<unsigned>> hosts;
+    for (int r = 0; r < lattice.nodes.number; r++)
+        hosts[host_of[r]].push_back(r);
+
+    int nblock = hosts.begin()->second.size();
+    bool uniform = true;
+    for (auto &h : hosts)
+        uniform = uniform && ((int)h.second.size() == nblock);
+
+    CoordinateVector blocksize, best;
+    int64_t surface = -1;
+    blocksize.fill(1);
+    if (!uniform || hosts.size() == 1 ||
+        !best_host_block(0, nblock, blocksize, best, surface)) {
+        hila::out0 << "Node remapping: NODE_LAYOUT_TOPOLOGY, " << hosts.size()
+                   << " hosts, ranks do not fit host blocks - no reordering\n";
+        return;
+    }
+    blocksize = best;
+
+    CoordinateVector blockdivs;
+    foralldir(d) blockdivs[d] = lattice.nodes.n_divisions[d] / blocksize[d];
+
+    hila::out0 << "Node remapping: NODE_LAYOUT_TOPOLOGY, " << hosts.size() << " hosts with "
+               << nblock << " ranks\n";
+    hila::out0 << "Host block size " << blocksize << "  block division " << blockdivs
+               << "  off-host surface/block " << surface << " sites\n";
+
+    lattice.nodes.map_array = (unsigned *)memalloc(lattice.nodes.number * sizeof(unsigned));
+    lattice.nodes.map_inverse = (unsigned *)memalloc(lattice.nodes.number * sizeof(unsigned));
+
+    std::vector<std::vector<unsigned> *> host_list;
+    for (auto &h : hosts)
+        host_list.push_back(&h.second);
+
+    for (int i = 0; i < lattice.nodes.number; i++) {
+        // lcoord is the coordinate of the logical node,
+        // bcoord the block coord and icoord coord inside block
+        CoordinateVector lcoord, bcoord, icoord;
+        int idiv = i;
+        foralldir(d) {
+            lcoord[d] = idiv % lattice.nodes.n_divisions[d];
+            idiv /= lattice.nodes.n_divisions[d];
+
+            bcoord[d] = lcoord[d] / blocksize[d];
+            icoord[d] = lcoord[d] % blocksize[d];
+        }
+
+        int ii, bi, im, bm;
+        ii = bi = 0;
+        im = bm = 1;
+        foralldir(d) {
+            ii += icoord[d] * im;
+            im *= blocksize[d];
+
+            bi += bcoord[d] * bm;
+            bm *= blockdivs[d];
+        }
+
+        // block bi goes to host bi, ii:th rank of it
+        unsigned rank = (*host_list[bi])[ii];
+        lattice.nodes.map_array[i] = rank;
+        lattice.nodes.map_inverse[rank] = i;
+    }
+}
+
+unsigned lattice_struct::allnodes::remap(unsigned i) const {
+    if (lattice.nodes.map_array == nullptr)
+        return i;
+    return lattice.nodes.map_array[i];
+}
+
+unsigned lattice_struct::allnodes::inverse_remap(unsigned i) const {
+    if (lattice.nodes.map_inverse == nullptr)
+        return i;
+    return lattice.nodes.map_inverse[i];
+}
+
+
 #elif defined(NODE_LAYOUT_BLOCK)
 
 ////////////////////////////////////////////////////////////////////
@@ -149,6 +307,6 @@ unsigned lattice_struct::allnodes::inverse_remap(unsigned idx) const {
 
 #else
 
-NODE_LAYOUT_BLOCK or NODE_LAYOUT_TRIVIAL must be defined
+NODE_LAYOUT_BLOCK, NODE_LAYOUT_TOPOLOGY or NODE_LAYOUT_TRIVIAL must be defined
 
 #endif
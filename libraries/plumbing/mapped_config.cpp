@@ -0,0 +1,65 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "plumbing/defs.h"
+#include "plumbing/mapped_config.h"
+
+//////////////////////////////////////////////////////////////////
+/// Memory mapped file access for mapped_config - see mapped_config.h
+//////////////////////////////////////////////////////////////////
+
+namespace hila {
+
+int open_mapped_file(const std::string &filename) {
+    return ::open(filename.c_str(), O_RDONLY);
+}
+
+void close_mapped_file(int fd) {
+    if (fd >= 0)
+        ::close(fd);
+}
+
+bool read_mapped_file(int fd, int64_t offset, void *buffer, size_t bytes) {
+    char *p = static_cast<char *>(buffer);
+    while (bytes > 0) {
+        ssize_t n = ::pread(fd, p, bytes, offset);
+        if (n <= 0)
+            return false;
+        p += n;
+        offset += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+int64_t mapped_file_size(int fd) {
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+        return -1;
+    return st.st_size;
+}
+
+mapped_range::mapped_range(int fd, int64_t offset, size_t bytes) {
+
+    // mmap offset has to be page aligned
+    static const int64_t page = ::sysconf(_SC_PAGESIZE);
+    int64_t start = offset - offset % page;
+    length = bytes + (offset - start);
+
+    base = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, start);
+    if (base == MAP_FAILED) {
+        hila::out << "ERROR: mmap of " << length << " bytes failed on rank " << hila::myrank()
+                  << '\n';
+        hila::terminate(5);
+    }
+    ptr = static_cast<const char *>(base) + (offset - start);
+}
+
+mapped_range::~mapped_range() {
+    if (base != nullptr && base != MAP_FAILED)
+        ::munmap(base, length);
+}
+
+} // namespace hila
@@ -0,0 +1,205 @@
+#ifndef MAPPED_CONFIG_H_
+#define MAPPED_CONFIG_H_
+
+//////////////////////////////////////////////////////////////////////
+/// Read-only memory mapped access to configuration files written by
+/// GaugeField::config_write() (full encoding, or old style files).
+///
+/// Unlike config_read(), nothing is streamed through rank 0.  The requested box is
+/// mapped one slab (fixed last coordinate) at a time, each mapping covering only the
+/// byte range from the first to the last requested site of the slab, and only the
+/// pages actually touched are read from the file.  For boxes with long x-runs, e.g. a
+/// few time slices of stored configurations, the data read is O(requested data)
+/// instead of O(lattice volume).  Short x-runs, e.g. a slice at fixed x, still read
+/// at least one page per run.
+/// The calls are not collective.  Checksum is not verified, because the whole
+/// file is not read.
+///
+/// Example:
+///     #include "plumbing/mapped_config.h"
+///     hila::mapped_config<SU<3, double>> cfg("config.dat");
+///     cfg.read(U);                                   // whole field, node block per rank
+///     auto links = cfg.get_slice(e_t, {-1, -1, -1, 5});  // t-links on time slice 5
+
+#include <cstring>
+
+#include "plumbing/defs.h"
+#include "plumbing/lattice.h"
+#include "plumbing/gaugefield.h"
+
+namespace hila {
+
+/// Low level helpers, see mapped_config.cpp.  Return negative / false on error
+int open_mapped_file(const std::string &filename);
+void close_mapped_file(int fd);
+bool read_mapped_file(int fd, int64_t offset, void *buffer, size_t bytes);
+int64_t mapped_file_size(int fd);
+
+/// Read-only mmap of a byte range of a file, unmapped in the destructor
+class mapped_range {
+  private:
+    void *base = nullptr;
+    size_t length = 0;
+    const char *ptr = nullptr;
+
+  public:
+    mapped_range(int fd, int64_t offset, size_t bytes);
+    ~mapped_range();
+    mapped_range(const mapped_range &) = delete;
+    mapped_range &operator=(const mapped_range &) = delete;
+
+    const char *data() const {
+        return ptr;
+    }
+};
+
+template <typename T>
+class mapped_config {
+  private:
+    int fd = -1;
+    std::string filename;
+    int64_t header_bytes = 0;
+
+    // position of the link in direction d at c in the file
+    int64_t link_offset(Direction d, const CoordinateVector &c) const {
+        int64_t idx = 0;
+        for (int dir = NDIM - 1; dir >= 0; dir--)
+            idx = idx * lattice.size(dir) + c[dir];
+        return header_bytes + ((int64_t)d * lattice.volume() + idx) * (int64_t)sizeof(T);
+    }
+
+    // check the header, as in GaugeField::config_read()
+    void check_header() {
+        using GF = GaugeField<T>;
+        std::string conferr("CONFIG ERROR in file " + filename + ": ");
+
+        int64_t flag = 0, words = 0, first = 1;
+        read_mapped_file(fd, 0, &flag, sizeof(int64_t));
+        if (flag == GF::config_flag) {
+            words = 3 + NDIM;
+            first = 1;
+        } else if (flag == GF::config_flag_encoded) {
+            read_mapped_file(fd, sizeof(int64_t), &words, sizeof(int64_t));
+            first = 2;
+        } else {
+            hila::out0 << conferr << "wrong id " << flag << '\n';
+            hila::terminate(1);
+        }
+
+        if (words < first + 2 + NDIM || words > 1024) {
+            hila::out0 << conferr << "corrupted header\n";
+            hila::terminate(1);
+        }
+
+        std::vector<int64_t> h(words);
+        if (!read_mapped_file(fd, 0, h.data(), words * sizeof(int64_t)) ||
+            h[first] != NDIM || h[first + 1] != sizeof(T)) {
+            hila::out0 << conferr << "wrong dimensionality or element size\n";
+            hila::terminate(1);
+        }
+        foralldir(d) {
+            if (h[first + 2 + d] != lattice.size(d)) {
+                hila::out0 << conferr << "incorrect lattice dimension " << hila::prettyprint(d)
+                           << " is " << h[first + 2 + d] << " should be " << lattice.size(d)
+                           << '\n';
+                hila::terminate(1);
+            }
+        }
+        if (flag == GF::config_flag_encoded &&
+            (words <= GF::config_encoding_word ||
+             h[GF::config_encoding_word] != hila::config_encoding::full)) {
+            hila::out0 << conferr << "mapped access needs full link encoding, use config_read\n";
+            hila::terminate(1);
+        }
+
+        header_bytes = words * sizeof(int64_t);
+        if (mapped_file_size(fd) < header_bytes + NDIM * lattice.volume() * (int64_t)sizeof(T)) {
+            hila::out0 << conferr << "file is too short\n";
+            hila::terminate(1);
+        }
+    }
+
+    // copy the links of box [cmin,cmax] to buffer, x fastest.  The box is mapped one slab
+    // of the last direction at a time, from the first to the last site of the box in the
+    // slab, so that at most one slab of the file is mapped at once
+    void read_box(Direction d, const CoordinateVector &cmin, const CoordinateVector &cmax,
+                  T *buffer) const {
+        constexpr int last = NDIM - 1;
+        const int64_t nx = cmax[0] - cmin[0] + 1;
+        CoordinateVector smin = cmin, smax = cmax;
+        size_t i = 0;
+        for (int s = cmin[last]; s <= cmax[last]; s++) {
+            smin[last] = smax[last] = s;
+            int64_t first = link_offset(d, smin);
+            hila::mapped_range map(fd, first, link_offset(d, smax) + sizeof(T) - first);
+
+            CoordinateVector c, rmax = smax;
+            rmax[0] = smin[0];
+            forcoordinaterange(c, smin, rmax) {
+                std::memcpy(buffer + i, map.data() + (link_offset(d, c) - first),
+                            nx * sizeof(T));
+                i += nx;
+            }
+        }
+    }
+
+  public:
+    mapped_config(const std::string &fname) : filename(fname) {
+        fd = open_mapped_file(filename);
+        if (fd < 0) {
+            hila::out0 << "ERROR in opening file " << filename << '\n';
+            hila::terminate(5);
+        }
+        check_header();
+    }
+
+    ~mapped_config() {
+        close_mapped_file(fd);
+    }
+
+    mapped_config(const mapped_config &) = delete;
+    mapped_config &operator=(const mapped_config &) = delete;
+
+    /// Read the whole configuration to U, each rank maps only its own node block
+    void read(GaugeField<T> &U) const {
+        std::vector<T> local(lattice.mynode.volume());
+        CoordinateVector nmax;
+        foralldir(d) nmax[d] = lattice.mynode.min[d] + lattice.mynode.size[d] - 1;
+        foralldir(d) {
+            read_box(d, lattice.mynode.min, nmax, local.data());
+            U[d].set_local_data(local);
+        }
+    }
+
+    /// Links in direction d of the box [cmin,cmax], x fastest as in Field::get_subvolume()
+    std::vector<T> get_subvolume(Direction d, const CoordinateVector &cmin,
+                                 const CoordinateVector &cmax) const {
+        size_t vol = 1;
+        foralldir(dir) {
+            assert(cmax[dir] >= cmin[dir] && cmin[dir] >= 0 && cmax[dir] < lattice.size(dir));
+            vol *= cmax[dir] - cmin[dir] + 1;
+        }
+        std::vector<T> res(vol);
+        read_box(d, cmin, cmax, res.data());
+        return res;
+    }
+
+    /// Links in direction d on a slice: coordinates c[dir] < 0 span the whole lattice,
+    /// as in Field::get_slice()
+    std::vector<T> get_slice(Direction d, const CoordinateVector &c) const {
+        CoordinateVector cmin, cmax;
+        foralldir(dir) {
+            if (c[dir] < 0) {
+                cmin[dir] = 0;
+                cmax[dir] = lattice.size(dir) - 1;
+            } else {
+                cmin[dir] = cmax[dir] = c[dir];
+            }
+        }
+        return get_subvolume(d, cmin, cmax);
+    }
+};
+
+} // namespace hila
+
+#endif
@@ -49,11 +49,13 @@
 #undef EVEN_SITES_FIRST
 #endif
 
-// NODE_LAYOUT_TRIVIAL or NODE_LAYOUT_BLOCK must be defined
+// NODE_LAYOUT_TRIVIAL, NODE_LAYOUT_TOPOLOGY or NODE_LAYOUT_BLOCK must be defined
 // Define NODE_LAYOUT_BLOCK to be the number of
 // MPI processes within a compute node - tries to maximize
 // locality somewhat
-#ifndef NODE_LAYOUT_TRIVIAL
+// NODE_LAYOUT_TOPOLOGY finds the ranks sharing a host at run time and places them
+// in blocks with minimal surface, see map_node_layout.cpp
+#if !defined(NODE_LAYOUT_TRIVIAL) && !defined(NODE_LAYOUT_TOPOLOGY)
 #ifndef NODE_LAYOUT_BLOCK
 #define NODE_LAYOUT_BLOCK 4
 #endif
@@ -65,6 +67,58 @@
 #define WRITE_BUFFER_SIZE 2000000
 #endif
 
+// Binary field writes and reads go through collective MPI-IO by default:
+// each rank accesses its own part of the file directly, file format is unchanged.
+// Set off (serial I/O through rank 0) by using -DPARALLEL_IO=0 in Makefile
+#ifndef PARALLEL_IO
+#define PARALLEL_IO
+#elif PARALLEL_IO == 0
+#undef PARALLEL_IO
+#endif
+
+// Number of general gathers (see Field::shift()) kept in the lattice, least recently
+// used ones are freed
+#ifndef GEN_GATHER_CACHE_SIZE
+#define GEN_GATHER_CACHE_SIZE 16
+#endif
+
+// Nearest neighbour gathers use persistent MPI requests (MPI_Recv_init/MPI_Send_init),
+// created once for each field, direction and parity, and restarted with MPI_Start.
+// This cuts the software overhead of small gathers.  Set off with -DPERSISTENT_GATHERS=0
+#ifndef PERSISTENT_GATHERS
+#define PERSISTENT_GATHERS
+#elif PERSISTENT_GATHERS == 0
+#undef PERSISTENT_GATHERS
+#endif
+
+// Poll the MPI progress engine in onsites() loops while their gathers are in flight:
+// with -wait-site-lists hilapp inserts hila::progress_comms() calls to the loop over the
+// interior sites, every COMM_PROGRESS_INTERVAL sites (a power of 2) on the main thread.
+// Many MPI implementations move the data only inside MPI calls, and without these the
+// gathers would progress only in wait_gather().  Set off with -DCOMM_PROGRESS=0
+#ifndef COMM_PROGRESS
+#define COMM_PROGRESS
+#elif COMM_PROGRESS == 0
+#undef COMM_PROGRESS
+#endif
+
+#ifndef COMM_PROGRESS_INTERVAL
+#define COMM_PROGRESS_INTERVAL 1024
+#endif
+
+// Halo exchange between ranks on the same host through an MPI-3 shared memory window:
+// the boundary sites are packed to the window and the neighbour copies them directly,
+// only short notification messages go through MPI.  Not used in gather_batch.
+// Switch on with -DSHARED_MEMORY_HALO in Makefile.  Not available on GPUs
+#if defined(SHARED_MEMORY_HALO) && SHARED_MEMORY_HALO == 0
+#undef SHARED_MEMORY_HALO
+#endif
+
+// Size of the shared memory pool of each rank for the halo send buffers, in MB
+#ifndef SHARED_HALO_POOL_MB
+#define SHARED_HALO_POOL_MB 64
+#endif
+
 
 // boundary conditions are "off" by default -- no need to do anything here
 // #ifndef SPECIAL_BOUNDARY_CONDITIONS
@@ -73,6 +127,9 @@
 // Special defines for GPU targets
 #if defined(CUDA) || defined(HIP)
 
+// halos are in device memory
+#undef SHARED_MEMORY_HALO
+
 // Use gpu memory pool by default
 // set off by using -DGPU_MEMORY_POOL=0 in Makefile
 #ifndef GPU_MEMORY_POOL
@@ -6,23 +6,75 @@
 
 #include <random>
 
-// #ifndef OPENMP
+#ifdef OPENMP
+#include <omp.h>
+#endif
 
 // static variable which holds the random state
-// Use 64-bit mersenne twister
-static std::mt19937_64 mersenne_twister_gen;
+// Use 64-bit mersenne twister, random numbers are in interval [0,1)
+// With OpenMP each thread has its own generator, so that site loops with random
+// numbers can be run in parallel.  Aligned to avoid false sharing of the states
+struct alignas(64) host_rng_struct {
+    std::mt19937_64 mersenne_twister_gen;
+    std::uniform_real_distribution<double> real_rnd_dist{0.0, 1.0};
+
+    double get() {
+        return real_rnd_dist(mersenne_twister_gen);
+    }
+};
 
-// random numbers are in interval [0,1)
-static std::uniform_real_distribution<double> real_rnd_dist(0.0, 1.0);
+#ifdef OPENMP
+static std::vector<host_rng_struct> host_rng(1);
 
-// #endif
+static inline host_rng_struct &thread_rng() {
+    assert((size_t)omp_get_thread_num() < host_rng.size() &&
+           "More OpenMP threads than random number generators, seed after omp_set_num_threads()");
+    return host_rng[omp_get_thread_num()];
+}
+#else
+static host_rng_struct host_rng;
+
+static inline host_rng_struct &thread_rng() {
+    return host_rng;
+}
+#endif
+
+#if defined(AVX) && !defined(HILAPP)
+// States of the vectorized generator, see backend_vector/defs.h.  These are seeded
+// separately from the mersenne twisters, so that hila::random() outside vectorized
+// loops gives the same numbers as before
+#ifdef OPENMP
+static std::vector<hila::vector_rng_state> vector_rng(1);
+
+hila::vector_rng_state &hila::thread_vector_rng() {
+    return vector_rng[omp_get_thread_num()];
+}
+#else
+static hila::vector_rng_state vector_rng;
+
+hila::vector_rng_state &hila::thread_vector_rng() {
+    return vector_rng;
+}
+#endif
+
+static void seed_vector_rng(hila::vector_rng_state &vs, uint64_t seed, uint64_t thread) {
+    std::seed_seq sseq{(uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)thread, 0x5eedU};
+    std::mt19937_64 gen(sseq);
+    uint64_t w[4];
+    for (auto &s : vs.s) {
+        for (auto &x : w)
+            x = gen();
+        s.load(w);
+    }
+}
+#endif
 
 
 // In GPU code hila::random() defined in hila_gpu.cpp
 #if !defined(CUDA) && !defined(HIP)
 
 double hila::random() {
-    return real_rnd_dist(mersenne_twister_gen);
+    return thread_rng().get();
 }
 
 #endif
@@ -30,7 +82,7 @@ double hila::random() {
 // Generate random number in non-kernel (non-loop) code.  Not meant to
 // be used in "user code"
 double hila::host_random() {
-    return real_rnd_dist(mersenne_twister_gen);
+    return thread_rng().get();
 }
 
 /////////////////////////////////////////////////////////////////////////
@@ -58,12 +110,37 @@ void initialize_host_rng(uint64_t seed) {
 
     seed = hila::shuffle_rng_seed(seed);
 
-    // #if !defined(OPENMP)
-    mersenne_twister_gen.seed(seed);
+#ifdef OPENMP
+    // Thread 0 gets the same stream as without OpenMP, the others are seeded with
+    // the thread number mixed in.  With a fixed number of threads the static
+    // schedule of the site loops makes the results reproducible
+    host_rng.resize(omp_get_max_threads());
+    for (size_t t = 0; t < host_rng.size(); t++) {
+        if (t == 0) {
+            host_rng[t].mersenne_twister_gen.seed(seed);
+        } else {
+            // seed_seq keeps 32-bit words, pass both halves of the seed
+            std::seed_seq sseq{(uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)t};
+            host_rng[t].mersenne_twister_gen.seed(sseq);
+        }
+        // warm it up
+        for (int i = 0; i < 9000; i++)
+            host_rng[t].mersenne_twister_gen();
+    }
+#if defined(AVX) && !defined(HILAPP)
+    vector_rng.resize(host_rng.size());
+    for (size_t t = 0; t < vector_rng.size(); t++)
+        seed_vector_rng(vector_rng[t], seed, t);
+#endif
+#else
+    host_rng.mersenne_twister_gen.seed(seed);
     // warm it up
     for (int i = 0; i < 9000; i++)
-        mersenne_twister_gen();
-    // #endif
+        host_rng.mersenne_twister_gen();
+#if defined(AVX) && !defined(HILAPP)
+    seed_vector_rng(vector_rng, seed, 0);
+#endif
+#endif
 }
 
 } // namespace hila
@@ -98,6 +175,12 @@ void hila::seed_random(uint64_t seed, bool device_init) {
 #ifndef SITERAND
 
     hila::out0 << "Using node random numbers, seed for node 0: " << seed << std::endl;
+#if defined(OPENMP) && !defined(CUDA) && !defined(HIP)
+    // thread generators: the random numbers depend on the number of threads
+    hila::out0 << "Using " << omp_get_max_threads()
+               << " OpenMP random number streams per node, site random numbers depend on "
+                  "OMP_NUM_THREADS\n";
+#endif
 
     hila::initialize_host_rng(seed);
 
@@ -179,8 +262,9 @@ double hila::gaussrand2(double &out2) {
 #if !defined(CUDA) && !defined(HIP)
 
 double hila::gaussrand() {
-    static double second;
-    static bool draw_new = true;
+    // thread_local: with OpenMP gaussrand() is called from several threads
+    static thread_local double second;
+    static thread_local bool draw_new = true;
     if (draw_new) {
         draw_new = false;
         return hila::gaussrand2(second);
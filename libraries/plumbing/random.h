@@ -54,6 +54,11 @@ bool is_device_rng_on();
 ///
 /// hila::random()  returns a uniform double precision random number in interval [0,1).  Can be
 /// called from outside or inside site loops (on GPU if the device rng is initialized)
+///
+/// With OPENMP each thread has its own generator, and site loops use a static schedule.  The
+/// numbers a site gets therefore depend on the number of threads (OMP_NUM_THREADS) as well as
+/// on the number of MPI ranks: runs are reproducible only with the same thread and rank counts.
+/// For results independent of the layout use the counter-based hila::site_rng (site_random.h).
 
 #pragma hila contains_rng loop_function
 double random();
@@ -29,6 +29,13 @@
 /// This does only one reduction operation, not for every onsites() -loop.
 /// Result is the same
 ///
+/// Blocking reductions ending in the same site loop, also those of plain variables
+/// and ReductionVectors, are done in one MPI collective for each number type:
+///
+///   Reduction<double> plaq = 0, act = 0;
+///   Reduction<Complex<double>> poly = 0;
+///   onsites(ALL) { plaq += ...; act += ...; poly += ...; }   // one MPI_Allreduce
+///
 /// Reduction variable can be used again
 ///
 
@@ -70,6 +77,13 @@ class Reduction {
 
         void *ptr = &val;
 
+        // blocking reduction at the end of a site loop: collect to the fused reduction
+        if (!is_nonblocking() && hila::is_fused_reduction()) {
+            hila::fused_reduction_setup(ptr, sizeof(T) / sizeof(hila::scalar_type<T>), dtype,
+                                        operation, is_allreduce());
+            return;
+        }
+
         reduction_timer.start();
         if (is_allreduce()) {
             if (is_nonblocking()) {
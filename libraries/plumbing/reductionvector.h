@@ -74,6 +74,14 @@ class ReductionVector {
             assert(sizeof(T) < 0 && "Unknown number_type in vector reduction");
         }
 
+        // blocking reduction at the end of a site loop: collect to the fused reduction
+        if (!is_nonblocking_ && hila::is_fused_reduction()) {
+            hila::fused_reduction_setup((void *)val.data(),
+                                        sizeof(T) * val.size() / sizeof(hila::scalar_type<T>),
+                                        dtype, operation, is_allreduce_);
+            return;
+        }
+
         reduction_timer.start();
         if (is_allreduce_) {
             if (is_nonblocking_) {
@@ -0,0 +1,503 @@
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+
+#include "plumbing/defs.h"
+#include "plumbing/lattice.h"
+#include "plumbing/com_mpi.h"
+#include "plumbing/shard_io.h"
+
+//////////////////////////////////////////////////////////////////
+/// Sharded field I/O - see shard_io.h for the description
+//////////////////////////////////////////////////////////////////
+
+// fingerprint of the manifest, on the 1st line.  Version 2 adds the generation number
+// to the shard names, version 1 file sets can still be read
+#define SHARD_MANIFEST_ID "hila-sharded-fields"
+#define SHARD_MANIFEST_VERSION 2
+
+// suffix of the manifest being written
+#define SHARD_TMP_SUFFIX ".tmp"
+
+namespace hila {
+
+std::string shard_filename(const std::string &filename, int64_t generation, int rank) {
+    if (generation == 0)
+        return filename + ".shard." + std::to_string(rank);
+    return filename + ".shard." + std::to_string(generation) + "." + std::to_string(rank);
+}
+
+/////////////////////////////////////////////////////////////////
+/// Write the shard of this rank - no MPI here
+
+bool write_shard(const std::string &shardname, const std::vector<const void *> &blocks,
+                 size_t element_size, uint32_t &checksum) {
+
+    size_t bytes = lattice.mynode.volume() * element_size;
+
+    std::ofstream out(shardname, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (out.fail())
+        return false;
+
+    checksum = 0;
+    for (auto b : blocks) {
+        out.write(static_cast<const char *>(b), bytes);
+        checksum = hila::crc32(checksum, b, bytes);
+    }
+    out.close();
+    return !out.fail();
+}
+
+/////////////////////////////////////////////////////////////////
+/// Collect the shard descriptions to rank 0 and write the manifest
+
+void write_shard_manifest(const std::string &filename, int64_t generation, int n_fields,
+                          size_t element_size, uint32_t checksum, bool ok) {
+
+    if (hila::check_input)
+        return;
+
+    int err = ok ? 0 : 1, anyerr;
+    MPI_Allreduce(&err, &anyerr, 1, MPI_INT, MPI_MAX, lattice.mpi_comm_lat);
+    if (anyerr) {
+        if (!ok)
+            hila::out << "ERROR in writing shard "
+                      << shard_filename(filename, generation, hila::myrank()) << '\n';
+        hila::out0 << "ERROR in writing sharded file " << filename << '\n';
+        hila::terminate(4);
+    }
+
+    shard_info my;
+    my.rank = hila::myrank();
+    for (int d = 0; d < NDIM; d++) {
+        my.min[d] = lattice.mynode.min[d];
+        my.size[d] = lattice.mynode.size[d];
+    }
+    my.checksum = checksum;
+
+    std::vector<shard_info> shards(hila::myrank() == 0 ? hila::number_of_nodes() : 0);
+    MPI_Gather(&my, sizeof(shard_info), MPI_BYTE, shards.data(), sizeof(shard_info), MPI_BYTE,
+               0, lattice.mpi_comm_lat);
+
+    if (hila::myrank() == 0) {
+        // write to a temporary name and rename: the manifest is replaced atomically,
+        // and until then it refers to the shards of the previous generation
+        std::string tmpname = filename + SHARD_TMP_SUFFIX;
+        std::ofstream out(tmpname, std::ios::out | std::ios::trunc);
+        out << SHARD_MANIFEST_ID << ' ' << SHARD_MANIFEST_VERSION << '\n';
+        out << "generation " << generation << '\n';
+        out << "ndim " << NDIM << '\n';
+        out << "lattice";
+        for (int d = 0; d < NDIM; d++)
+            out << ' ' << lattice.size(d);
+        out << "\ndivisions";
+        for (int d = 0; d < NDIM; d++)
+            out << ' ' << lattice.nodes.n_divisions[d];
+        out << "\nranks " << shards.size() << '\n';
+        out << "fields " << n_fields << '\n';
+        out << "element_size " << element_size << '\n';
+        for (auto &s : shards) {
+            out << "shard " << s.rank << " min";
+            for (int d = 0; d < NDIM; d++)
+                out << ' ' << s.min[d];
+            out << " size";
+            for (int d = 0; d < NDIM; d++)
+                out << ' ' << s.size[d];
+            out << " crc32 " << s.checksum << '\n';
+        }
+        out.close();
+        ok = !out.fail() && std::rename(tmpname.c_str(), filename.c_str()) == 0;
+    }
+
+    if (!hila::broadcast(ok)) {
+        hila::out0 << "ERROR in writing manifest " << filename << '\n';
+        hila::terminate(4);
+    }
+}
+
+/////////////////////////////////////////////////////////////////
+/// Generation and number of shards of the file set which is replaced.  Generation
+/// is -1 if there is no file set.  Collective
+
+struct shard_generation {
+    int64_t generation;
+    int64_t ranks;
+};
+
+static shard_generation previous_generation(const std::string &filename) {
+    shard_generation prev = {-1, 0};
+    if (hila::myrank() == 0) {
+        std::ifstream in(filename);
+        std::string key;
+        int version = 0;
+        if (in >> key >> version && key == SHARD_MANIFEST_ID) {
+            prev.generation = 0; // version 1
+            while (in >> key && key != "shard") {
+                if (key == "generation")
+                    in >> prev.generation;
+                else if (key == "ranks")
+                    in >> prev.ranks;
+            }
+        }
+    }
+    hila::broadcast(prev);
+    return prev;
+}
+
+/// Remove the shards of the replaced file set, each rank removes a part of them
+static void remove_shards(const std::string &filename, const shard_generation &prev) {
+    if (prev.generation < 0)
+        return;
+    for (int64_t r = hila::myrank(); r < prev.ranks; r += hila::number_of_nodes())
+        std::remove(shard_filename(filename, prev.generation, r).c_str());
+}
+
+/////////////////////////////////////////////////////////////////
+/// Each write makes a new generation of shard files, and the manifest is replaced
+/// only after all shards are complete.  Thus the manifest on disk always refers to
+/// complete shards, also if the job is killed during the write.  The shards of the
+/// previous generation are removed after the new manifest is in place
+
+void write_shards(const std::string &filename, const std::vector<const void *> &blocks,
+                  size_t element_size) {
+    if (hila::check_input)
+        return;
+
+    shard_generation prev = previous_generation(filename);
+    int64_t generation = std::max<int64_t>(prev.generation, 0) + 1;
+
+    uint32_t checksum = 0;
+    bool ok = write_shard(shard_filename(filename, generation, hila::myrank()), blocks,
+                          element_size, checksum);
+    write_shard_manifest(filename, generation, blocks.size(), element_size, checksum, ok);
+    remove_shards(filename, prev);
+}
+
+/////////////////////////////////////////////////////////////////
+/// Asynchronous write: the shard is written by a thread, the manifest in
+/// wait_checkpoint().  The writer thread makes no MPI calls
+
+static struct async_shard_write {
+    std::thread writer;
+    std::string filename;
+    shard_generation previous;
+    int64_t generation;
+    int n_fields;
+    size_t element_size;
+    uint32_t checksum;
+    bool ok;
+    bool pending = false;
+    std::shared_ptr<void> staging;
+
+    // exit() while a write is in flight: the thread must not be left running
+    ~async_shard_write() {
+        if (writer.joinable())
+            writer.join();
+    }
+} async_write;
+
+void write_shards_async(const std::string &filename, const std::vector<const void *> &blocks,
+                        size_t element_size, std::shared_ptr<void> keep_alive) {
+
+    // only one write in flight
+    wait_checkpoint();
+
+    if (hila::check_input)
+        return;
+
+    async_write.filename = filename;
+    async_write.previous = previous_generation(filename);
+    async_write.generation = std::max<int64_t>(async_write.previous.generation, 0) + 1;
+    async_write.n_fields = blocks.size();
+    async_write.element_size = element_size;
+    async_write.checksum = 0;
+    async_write.ok = false;
+    async_write.staging = std::move(keep_alive);
+    async_write.pending = true;
+
+    std::string shardname = shard_filename(filename, async_write.generation, hila::myrank());
+    async_write.writer = std::thread([shardname, blocks, element_size]() {
+        async_write.ok = write_shard(shardname, blocks, element_size, async_write.checksum);
+    });
+}
+
+bool wait_checkpoint() {
+
+    if (!async_write.pending)
+        return false;
+
+    join_checkpoint_writer();
+
+    write_shard_manifest(async_write.filename, async_write.generation, async_write.n_fields,
+                         async_write.element_size, async_write.checksum, async_write.ok);
+    remove_shards(async_write.filename, async_write.previous);
+
+    return true;
+}
+
+void join_checkpoint_writer() {
+    if (async_write.writer.joinable())
+        async_write.writer.join();
+    async_write.staging.reset();
+    async_write.pending = false;
+}
+
+/////////////////////////////////////////////////////////////////
+/// Parse the manifest on rank 0.  Returns false and prints the reason
+/// if the manifest is not usable
+
+static bool parse_shard_manifest(const std::string &filename, int n_fields, size_t element_size,
+                                 int64_t &generation, std::vector<shard_info> &shards) {
+
+    std::string err("SHARDED FILE ERROR in " + filename + ": ");
+
+    std::ifstream in(filename);
+    if (in.fail()) {
+        hila::out0 << "ERROR in opening file " << filename << '\n';
+        return false;
+    }
+
+    std::string key;
+    int version = 0;
+    in >> key >> version;
+    if (key != SHARD_MANIFEST_ID || version < 1 || version > SHARD_MANIFEST_VERSION) {
+        hila::out0 << err << "not a manifest of sharded file set\n";
+        return false;
+    }
+
+    generation = 0; // version 1
+
+    int64_t ndim = 0, nranks = 0, nf = 0, esize = 0;
+    CoordinateVector lsize;
+    while (in >> key && key != "shard") {
+        if (key == "generation") {
+            in >> generation;
+        } else if (key == "ndim") {
+            in >> ndim;
+            if (ndim != NDIM) {
+                hila::out0 << err << "wrong dimensionality, should be " << NDIM << " is "
+                           << ndim << '\n';
+                return false;
+            }
+        } else if (key == "lattice") {
+            foralldir(d) {
+                in >> lsize[d];
+                if (lsize[d] != lattice.size(d)) {
+                    hila::out0 << err << "incorrect lattice dimension " << hila::prettyprint(d)
+                               << " is " << lsize[d] << " should be " << lattice.size(d)
+                               << '\n';
+                    return false;
+                }
+            }
+        } else if (key == "divisions") {
+            // informative only, the shard boxes tell the layout
+            for (int d = 0; d < NDIM; d++)
+                in >> lsize[d];
+        } else if (key == "ranks") {
+            in >> nranks;
+        } else if (key == "fields") {
+            in >> nf;
+            if (nf != n_fields) {
+                hila::out0 << err << "wrong number of fields, should be " << n_fields << " is "
+                           << nf << '\n';
+                return false;
+            }
+        } else if (key == "element_size") {
+            in >> esize;
+            if (esize != (int64_t)element_size) {
+                hila::out0 << err << "wrong size of field element, should be " << element_size
+                           << " is " << esize << '\n';
+                return false;
+            }
+        } else {
+            hila::out0 << err << "unknown key '" << key << "'\n";
+            return false;
+        }
+    }
+
+    if (ndim == 0 || nranks <= 0 || nf == 0 || esize == 0) {
+        hila::out0 << err << "incomplete manifest\n";
+        return false;
+    }
+
+    // now at "shard" lines
+    shards.resize(nranks);
+    int64_t sites = 0;
+    for (int i = 0; i < nranks; i++) {
+        if (i > 0)
+            in >> key;
+        std::string kmin, ksize, kcrc;
+        shard_info &s = shards[i];
+        in >> s.rank >> kmin;
+        for (int d = 0; d < NDIM; d++)
+            in >> s.min[d];
+        in >> ksize;
+        for (int d = 0; d < NDIM; d++)
+            in >> s.size[d];
+        in >> kcrc >> s.checksum;
+
+        if (in.fail() || key != "shard" || kmin != "min" || ksize != "size" || kcrc != "crc32") {
+            hila::out0 << err << "malformed shard line " << i << '\n';
+            return false;
+        }
+        int64_t v = 1;
+        for (int d = 0; d < NDIM; d++)
+            v *= s.size[d];
+        sites += v;
+    }
+
+    if (sites != lattice.volume()) {
+        hila::out0 << err << "shards do not cover the lattice\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool is_shard_manifest(const std::string &filename) {
+    bool is_manifest = false;
+    if (hila::myrank() == 0) {
+        std::ifstream in(filename);
+        std::string key;
+        if (in >> key)
+            is_manifest = (key == SHARD_MANIFEST_ID);
+    }
+    return hila::broadcast(is_manifest);
+}
+
+/////////////////////////////////////////////////////////////////
+/// Copy the part [lo,hi) of a field block of shard s to the node-local field block,
+/// line by line (x-direction is contiguous in both)
+
+static void copy_shard_overlap(const char *shard, const shard_info &s, const CoordinateVector &lo,
+                               const CoordinateVector &hi, char *block, size_t element_size) {
+
+    const CoordinateVector &mymin = lattice.mynode.min;
+    const auto &myfactor = lattice.mynode.size_factor;
+
+    size_t shard_sites = 1;
+    Vector<NDIM, size_t> sfactor;
+    foralldir(d) {
+        sfactor[d] = shard_sites;
+        shard_sites *= s.size[d];
+    }
+    size_t line = (hi[e_x] - lo[e_x]) * element_size;
+
+    CoordinateVector c = lo;
+    bool done = false;
+    while (!done) {
+        size_t sidx = 0, myidx = 0;
+        foralldir(d) {
+            sidx += (c[d] - s.min[d]) * sfactor[d];
+            myidx += (c[d] - mymin[d]) * myfactor[d];
+        }
+        std::memcpy(block + myidx * element_size, shard + sidx * element_size, line);
+
+        // next line: step the coordinates above x
+        done = true;
+        for (int d = 1; d < NDIM; d++) {
+            if (++c[d] < hi[d]) {
+                done = false;
+                break;
+            }
+            c[d] = lo[d];
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////
+/// Read the shards overlapping with this node.  Each shard is read as contiguous field
+/// blocks and its checksum is verified.  If the shard matches the node block it is read
+/// directly to the field blocks, otherwise one field block at a time is read to a buffer
+/// and the overlapping part is copied.
+
+bool read_shards(const std::string &filename, const std::vector<void *> &blocks,
+                 size_t element_size) {
+
+    if (hila::check_input)
+        return true;
+
+    std::vector<shard_info> shards;
+    int64_t generation = 0;
+    bool ok = true;
+    if (hila::myrank() == 0)
+        ok = parse_shard_manifest(filename, blocks.size(), element_size, generation, shards);
+
+    if (!hila::broadcast(ok))
+        hila::terminate(1);
+
+    hila::broadcast(shards);
+    hila::broadcast(generation);
+
+    const CoordinateVector &mymin = lattice.mynode.min;
+    const CoordinateVector &mysize = lattice.mynode.size;
+
+    size_t sites_read = 0;
+    std::string error;
+    std::vector<char> buffer;
+
+    for (const auto &s : shards) {
+        CoordinateVector lo, hi;
+        bool overlap = true, same_box = true;
+        size_t shard_sites = 1, overlap_sites = 1;
+        foralldir(d) {
+            lo[d] = std::max(mymin[d], s.min[d]);
+            hi[d] = std::min(mymin[d] + mysize[d], s.min[d] + s.size[d]);
+            overlap = overlap && (lo[d] < hi[d]);
+            same_box = same_box && (s.min[d] == mymin[d]) && (s.size[d] == mysize[d]);
+            shard_sites *= s.size[d];
+            overlap_sites *= std::max(hi[d] - lo[d], 0);
+        }
+        if (!overlap)
+            continue;
+
+        std::string shardname = shard_filename(filename, generation, s.rank);
+        std::ifstream in(shardname, std::ios::in | std::ios::binary);
+        if (in.fail()) {
+            error = "cannot open shard " + shardname;
+            break;
+        }
+
+        size_t shard_bytes = shard_sites * element_size;
+        if (!same_box)
+            buffer.resize(shard_bytes);
+
+        uint32_t checksum = 0;
+        for (auto b : blocks) {
+            char *to = same_box ? static_cast<char *>(b) : buffer.data();
+            in.read(to, shard_bytes);
+            if (in.fail())
+                break;
+            checksum = hila::crc32(checksum, to, shard_bytes);
+            if (!same_box)
+                copy_shard_overlap(to, s, lo, hi, static_cast<char *>(b), element_size);
+        }
+        if (in.fail()) {
+            error = "error reading shard " + shardname;
+            break;
+        }
+        if (checksum != s.checksum) {
+            error = "checksum mismatch in shard " + shardname;
+            break;
+        }
+        sites_read += overlap_sites;
+    }
+
+    if (error.empty() && sites_read != lattice.mynode.volume())
+        error = "shards do not cover the node block";
+
+    int err = error.empty() ? 0 : 1, anyerr;
+    MPI_Allreduce(&err, &anyerr, 1, MPI_INT, MPI_MAX, lattice.mpi_comm_lat);
+    if (anyerr) {
+        if (err)
+            hila::out << "SHARDED FILE ERROR on rank " << hila::myrank() << ": " << error << '\n';
+        hila::out0 << "ERROR in reading sharded file " << filename << '\n';
+        hila::terminate(1);
+    }
+
+    return true;
+}
+
+} // namespace hila
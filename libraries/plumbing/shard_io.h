@@ -0,0 +1,89 @@
+#ifndef SHARD_IO_H_
+#define SHARD_IO_H_
+
+//////////////////////////////////////////////////////////////////////
+/// Sharded (one file per rank) I/O of node-local field data.
+///
+/// A sharded file set "name" consists of a small text manifest "name" and
+/// the shards "name.shard.<generation>.<rank>".  A shard holds the node block of its
+/// rank for all stored fields, field after field, sites in the order of
+/// Field::copy_local_data().  The manifest records the generation, lattice size, node
+/// divisions, element size and number of fields, and the box and CRC32 checksum of each
+/// shard.
+///
+/// Each write of the set makes a new generation of shards, and the manifest is written
+/// to a temporary file and renamed over the old one when all shards are complete.  If
+/// the job dies during the write, the manifest still refers to the complete shards of
+/// the previous generation.  These are removed after the new manifest is in place.
+/// (Sets written before the generation numbers have shards "name.shard.<rank>"; they
+/// can be read and are replaced normally.)
+///
+/// Writing is O(local volume) on each rank and needs no communication except for the
+/// manifest. The set can be read back with a different number of ranks or node layout:
+/// each rank then reads the shards which overlap its own node block, one contiguous field
+/// block at a time, and keeps the overlapping part.  Shard checksums are always verified.
+
+#include "plumbing/defs.h"
+#include "plumbing/checksum.h"
+#include <memory>
+
+namespace hila {
+
+/// Description of one shard in the manifest
+struct shard_info {
+    int rank;
+    int min[NDIM], size[NDIM];
+    uint32_t checksum;
+};
+
+/// Name of the shard file of rank in the given generation of the file set
+std::string shard_filename(const std::string &filename, int64_t generation, int rank);
+
+/// Write the shard file of this rank. Blocks point to the node-local data of the fields,
+/// lattice.mynode.volume() elements of element_size bytes each.
+/// No MPI calls are made, so this can be called from a writer thread.
+/// Returns false on error; checksum of the shard is returned in argument checksum.
+bool write_shard(const std::string &shardname, const std::vector<const void *> &blocks,
+                 size_t element_size, uint32_t &checksum);
+
+/// Write the manifest of a sharded file set after the shards of the generation are
+/// written. Collective, the checksums of all ranks are collected to rank 0 which writes
+/// the manifest.  Argument ok tells if write_shard() succeeded, terminates if any failed.
+void write_shard_manifest(const std::string &filename, int64_t generation, int n_fields,
+                          size_t element_size, uint32_t checksum, bool ok);
+
+/// Write a sharded file set: write_shard() of a new generation + write_shard_manifest(),
+/// and remove the shards of the previous generation. Collective
+void write_shards(const std::string &filename, const std::vector<const void *> &blocks,
+                  size_t element_size);
+
+/// Asynchronous version of write_shards(): the shard of this rank is written by a
+/// background thread from the staging buffers pointed to by blocks.  Keep_alive owns
+/// the staging buffers and is released when the write is done, so the caller can
+/// continue modifying the fields immediately.  The manifest is written in
+/// wait_checkpoint(), which must be called before the new file set is used; until
+/// then the file set is the previous one.  A pending write is completed first.
+void write_shards_async(const std::string &filename, const std::vector<const void *> &blocks,
+                        size_t element_size, std::shared_ptr<void> keep_alive);
+
+/// Complete a pending asynchronous write: wait for the writer thread and replace the
+/// manifest. Collective, no-op if there is nothing pending. Returns true if a write
+/// was completed
+bool wait_checkpoint();
+
+/// Wait for the writer thread of a pending asynchronous write without completing it,
+/// the previous file set stays valid. Not collective, called by hila::terminate().
+/// (The writer is also joined at exit().)
+void join_checkpoint_writer();
+
+/// Read a sharded file set to node-local blocks (ordered as in Field::set_local_data()),
+/// redistributing the data if the node layout differs from the written one. Collective
+bool read_shards(const std::string &filename, const std::vector<void *> &blocks,
+                 size_t element_size);
+
+/// Return true if the file is a manifest of a sharded file set
+bool is_shard_manifest(const std::string &filename);
+
+} // namespace hila
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef SITE_RANDOM_H_
+#define SITE_RANDOM_H_
+
+//////////////////////////////////////////////////////////////////////
+/// Counter-based random numbers for site loops (Philox4x32-10, Salmon et al. 2011).
+///
+/// Random number n of a site is a pure function of (seed, global site coordinates,
+/// sweep, n).  Results do not depend on the number of MPI ranks, OpenMP threads,
+/// vector length or the order in which the sites are visited, so that Markov chains
+/// are bit-identical on any layout.  There is no generator state: the loops stay
+/// parallel and vectorizable, and no memory is used for the RNG on GPUs.
+///
+///     hila::site_rng rng(seed);
+///     for (int sweep = 0; ...) {
+///         onsites(ALL) {
+///             double u = rng.random(X.coordinates(), 0);    // 1st number of the site
+///             double g = rng.gaussian(X.coordinates(), 1);  // 2nd
+///             ...
+///         }
+///         rng.next_sweep();
+///     }
+///
+/// The numbers are different for each n, so each use of a random number in the loop
+/// body should have its own n.  If the same site is updated several times within one
+/// sweep, e.g. in even-odd updates of different directions, use different n or
+/// call next_sweep() between the loops.
+/// Unlike hila::random(), the seed is not shuffled with the MPI rank.
+
+#include "plumbing/defs.h"
+#include "plumbing/coordinates.h"
+#include "plumbing/lattice.h"
+
+namespace hila {
+
+/// One Philox4x32-10 block: 4 random 32-bit words from the 128-bit counter and 64-bit key
+#pragma hila loop_function
+inline void philox4x32(uint32_t ctr[4], uint32_t k0, uint32_t k1) {
+    for (int round = 0; round < 10; round++) {
+        uint64_t p0 = (uint64_t)0xD2511F53U * ctr[0];
+        uint64_t p1 = (uint64_t)0xCD9E8D57U * ctr[2];
+        uint32_t c0 = (uint32_t)(p1 >> 32) ^ ctr[1] ^ k0;
+        uint32_t c2 = (uint32_t)(p0 >> 32) ^ ctr[3] ^ k1;
+        ctr[0] = c0;
+        ctr[1] = (uint32_t)p1;
+        ctr[2] = c2;
+        ctr[3] = (uint32_t)p0;
+        k0 += 0x9E3779B9U;
+        k1 += 0xBB67AE85U;
+    }
+}
+
+/// Counter-based generator.  The object is small and trivially copyable, and is used
+/// as a constant inside site loops
+class site_rng {
+  private:
+    uint32_t key[2];
+    uint32_t sweep;
+    int64_t stride[NDIM];
+
+    // 4 random words of block n of site c
+#pragma hila loop_function
+    void block(const CoordinateVector &c, uint32_t n, uint32_t r[4]) const {
+        int64_t idx = 0;
+        foralldir(d) idx += c[d] * stride[d];
+        r[0] = (uint32_t)idx;
+        r[1] = (uint32_t)(idx >> 32);
+        r[2] = sweep;
+        r[3] = n;
+        philox4x32(r, key[0], key[1]);
+    }
+
+    // double in [0,1) from 2 words, 53 bits
+#pragma hila loop_function
+    static double to_double(uint32_t hi, uint32_t lo) {
+        return (((uint64_t)hi << 21) ^ (lo >> 11)) * (1.0 / 9007199254740992.0);
+    }
+
+  public:
+    site_rng(uint64_t seed = 0) {
+        set_seed(seed);
+    }
+
+    void set_seed(uint64_t seed) {
+        key[0] = (uint32_t)seed;
+        key[1] = (uint32_t)(seed >> 32);
+        sweep = 0;
+        int64_t s = 1;
+        foralldir(d) {
+            stride[d] = s;
+            s *= lattice.size(d);
+        }
+    }
+
+    /// Move to new random numbers on all sites.  Call outside site loops, on all ranks
+    void next_sweep() {
+        sweep++;
+    }
+    void set_sweep(uint32_t s) {
+        sweep = s;
+    }
+    uint32_t get_sweep() const {
+        return sweep;
+    }
+
+    /// Uniform random number in [0,1), number n of site c on this sweep
+#pragma hila loop_function
+    double random(const CoordinateVector &c, uint32_t n = 0) const {
+        uint32_t r[4];
+        block(c, n & 0x7fffffffU, r);
+        return to_double(r[0], r[1]);
+    }
+
+    /// Gaussian random number with variance 1 (see hila::gaussrand()), number n of
+    /// site c on this sweep.  Independent of the uniform numbers random(c, n)
+#pragma hila loop_function
+    double gaussian(const CoordinateVector &c, uint32_t n = 0) const {
+        uint32_t r[4];
+        block(c, n | 0x80000000U, r);
+        double phi = 2.0 * M_PI * to_double(r[0], r[1]);
+        double u = 1.0 - to_double(r[2], r[3]); // in (0,1]
+        return sqrt(-2.0 * ::log(u)) * sin(phi);
+    }
+};
+
+} // namespace hila
+
+#endif
@@ -0,0 +1,76 @@
+#include "hila.h"
+#include "dirac/conjugate_gradient.h"
+#include "catch.hpp"
+
+// Test operator M = m + (1/2) sum_d (f[X+d] - f[X-d]), as a staggered operator without
+// gauge and phase factors.  The hopping part is antihermitean, so M^dagger M = m^2 - hop^2
+// is positive definite
+template <typename T>
+class TestOperator {
+  public:
+    using vector_type = T;
+    Parity par = ALL;
+    double mass;
+
+    TestOperator(double m) : mass(m) {}
+
+    void apply(const Field<T> &in, Field<T> &out) {
+        hop(in, out, 1);
+    }
+
+    void dagger(const Field<T> &in, Field<T> &out) {
+        hop(in, out, -1);
+    }
+
+  private:
+    void hop(const Field<T> &in, Field<T> &out, int sign) {
+        out[ALL] = mass * in[X];
+        foralldir(d) out[ALL] += (0.5 * sign) * (in[X + d] - in[X - d]);
+    }
+};
+
+// Solve M^dagger M x = a with CG and PipelinedCG.  Both true residuals must be within the
+// solver accuracy, and the solutions must agree
+template <typename T>
+void compare_cg_solvers(const char *name) {
+    const double accuracy = 1e-10;
+    TestOperator<T> M(0.5);
+    Field<T> a, x_cg, x_pcg, Mx, MdMx;
+    onsites(ALL) hila::gaussian_random(a[X]);
+    x_cg = 0;
+    x_pcg = 0;
+
+    CG<TestOperator<T>> cg(M, accuracy);
+    PipelinedCG<TestOperator<T>> pcg(M, accuracy);
+    cg.apply(a, x_cg);
+    pcg.apply(a, x_pcg);
+
+    double source = a.squarenorm();
+    M.apply(x_cg, Mx);
+    M.dagger(Mx, MdMx);
+    double res_cg = (a - MdMx).squarenorm() / source;
+    M.apply(x_pcg, Mx);
+    M.dagger(Mx, MdMx);
+    double res_pcg = (a - MdMx).squarenorm() / source;
+    double diff = (x_cg - x_pcg).squarenorm() / x_cg.squarenorm();
+
+    INFO(name << ": CG residual " << res_cg << ", PipelinedCG residual " << res_pcg
+              << ", solution difference " << diff);
+    // the recurred residuals drift a little from the true ones, allow a factor 10
+    REQUIRE(res_cg < 100 * accuracy * accuracy);
+    REQUIRE(res_pcg < 100 * accuracy * accuracy);
+    // the condition number of M^dagger M is (m^2 + NDIM) / m^2 < 20
+    REQUIRE(diff < 400 * 100 * accuracy * accuracy);
+}
+
+TEST_CASE("PipelinedCG agrees with CG", "[CG]") {
+    SECTION("Real field") {
+        compare_cg_solvers<double>("double");
+    }
+    SECTION("Complex field") {
+        compare_cg_solvers<Complex<double>>("Complex<double>");
+    }
+    SECTION("Vector field") {
+        compare_cg_solvers<Vector<3, Complex<double>>>("Vector<3,Complex<double>>");
+    }
+}
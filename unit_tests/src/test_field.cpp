@@ -1,4 +1,5 @@
 #include "hila.h"
+#include "plumbing/mapped_config.h"
 #include "catch.hpp"
 
 using MyType = float;
@@ -91,6 +92,22 @@ TEST_CASE_METHOD(FieldTest, "Field get and set element", "[FieldAssignment]") {
         MyType dummy_field_element = dummy_field.get_element({2,2,2});
         REQUIRE(temporary_field_element == dummy_field_element);
     }
+    SECTION("Element query with different sites on each rank") {
+        std::vector<CoordinateVector> clist;
+        CoordinateVector c = 0;
+        for (int i = 0; i <= hila::myrank() % lattice.size(e_x); i++) {
+            c[e_x] = i;
+            clist.push_back(c);
+        }
+        hila::element_query q(clist);
+        std::vector<MyType> v = q.get(dummy_field);
+        REQUIRE(v.size() == clist.size());
+        REQUIRE(v.back() == dummy_field.get_element(c));
+        for (auto &e : v)
+            e = 2;
+        q.set(temporary_field, v);
+        REQUIRE(temporary_field.get_element({0, 0, 0}) == 2);
+    }
     // SECTION("Field set element") {
     //     temporary_field.set_element(100,{2,2,2});
     //     dummy_field.set_element(100,{2,2,2});
@@ -122,6 +139,67 @@ TEST_CASE_METHOD(FieldTest, "Field arithmetic", "[Field]") {
     }
 }
 
+// used to check that Field operators still return Fields
+template <typename T>
+T field_sum(const Field<T> &f) {
+    return f.sum();
+}
+
+TEST_CASE_METHOD(FieldTest, "Field operators return Fields", "[Field]") {
+    Field<double> a = 1, b = 2, c = 3, d = 4;
+    static_assert(std::is_same<decltype(a + b * c - d), Field<double>>::value, "");
+    static_assert(std::is_same<decltype(2 * a - b / d), Field<double>>::value, "");
+    static_assert(std::is_same<decltype(-a), Field<double>>::value, "");
+    static_assert(std::is_same<decltype(exp(a)), Field<double>>::value, "");
+    SECTION("auto holds the value") {
+        auto x = a + b;
+        a = 10;
+        REQUIRE(x == Field<double>(3));
+    }
+    SECTION("Template argument deduction") {
+        REQUIRE(field_sum(a + b) == 3 * lattice.volume());
+        REQUIRE(field_sum(-a) == -lattice.volume());
+    }
+    SECTION("Same results as lazy expressions") {
+        Field<double> f = hila::lazy(a) + hila::lazy(b) * c - d;
+        REQUIRE(f == a + b * c - d);
+        f = 2 * hila::lazy(a) - hila::lazy(b) / d;
+        REQUIRE(f == 2 * a - b / d);
+        f = -hila::lazy(a);
+        REQUIRE(f == -a);
+        f = exp(hila::lazy(a) - 1) + pow(hila::lazy(b), 2);
+        REQUIRE(f == exp(a - 1) + pow(b, 2));
+    }
+}
+
+TEST_CASE_METHOD(FieldTest, "Lazy Field expressions", "[Field]") {
+    Field<double> a = 1, b = 2, c = 3, d = 4, f;
+    SECTION("Expression in one loop") {
+        f = hila::lazy(a) + hila::lazy(b) * c - d;
+        REQUIRE(f == Field<double>(3));
+        REQUIRE((2 * hila::lazy(a) - hila::lazy(b) / d) == Field<double>(1.5));
+        REQUIRE(-hila::lazy(a) == Field<double>(-1));
+    }
+    SECTION("Long expression") {
+        auto p = hila::lazy(a) * b * c * d;
+        f = hila::lazy(a) + b + c + d + p;
+        REQUIRE(f == Field<double>(34));
+    }
+    SECTION("Compound assignment") {
+        f = a;
+        f += hila::lazy(b) * c;
+        f -= 2 * hila::lazy(a);
+        REQUIRE(f == Field<double>(5));
+    }
+    SECTION("Reductions and functions") {
+        REQUIRE(squarenorm(hila::lazy(d) - b) == 4 * lattice.volume());
+        REQUIRE(squarenorm_relative(hila::lazy(a) * b, b) == 0);
+        Field<Complex<double>> z = Complex<double>(0, 1) * hila::lazy(c) + a;
+        REQUIRE((conj(hila::lazy(z)) * z).eval().sum().re == 10 * lattice.volume());
+        REQUIRE((exp(hila::lazy(a) - 1) + pow(b, 2)) == Field<double>(5));
+    }
+}
+
 //UNARY OPERATOR?
 
 TEST_CASE_METHOD(FieldTest, "Field mathematical operations", "[Field]") {
@@ -135,6 +213,25 @@ TEST_CASE_METHOD(FieldTest, "Field mathematical operations", "[Field]") {
     SECTION("Product reduction") {
         REQUIRE(dummy_field.product() == 1);
     }
+    SECTION("Several reductions in one loop") {
+        Reduction<double> rd = 0;
+        Reduction<Complex<double>> rc;
+        Reduction<int64_t> ri = 0;
+        ReductionVector<double> rv(2);
+        double d = 0;
+        onsites(ALL) {
+            rd += dummy_field[X];
+            rc += Complex<double>(0, dummy_field[X]);
+            ri += 1;
+            rv[X.parity() == EVEN ? 0 : 1] += dummy_field[X];
+            d += 2 * dummy_field[X];
+        }
+        REQUIRE(rd.value() == lattice.volume());
+        REQUIRE(rc.value().im == lattice.volume());
+        REQUIRE(ri.value() == lattice.volume());
+        REQUIRE(rv[0] + rv[1] == lattice.volume());
+        REQUIRE(d == 2 * lattice.volume());
+    }
     SECTION("MinMax") {
         dummy_field[{2,2,2}] = 2.0;
         dummy_field[{2,2,2}] = 2.0;
@@ -146,4 +243,578 @@ TEST_CASE_METHOD(FieldTest, "Field mathematical operations", "[Field]") {
         REQUIRE(dummy_field.min(EVEN,loc_min) == 1.0);    
         REQUIRE(dummy_field.max(ODD,loc_max) == 1.0);        
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE_METHOD(FieldTest, "Adjacent site loops", "[Field]") {
+    // hilapp may fuse these loops (option -loop-fusion, e.g.
+    // make CUSTOM_HILAPP_OPTS=-loop-fusion).  Results must be the same with and without.
+    Field<double> a, b, c;
+    double n = lattice.volume();
+    CoordinateVector v = 0;
+    SECTION("Independent loops") {
+        onsites(ALL) a[X] = X.coordinate(e_x);
+        onsites(ALL) b[X] = 2 * a[X] + 1;
+        v[e_x] = 3;
+        REQUIRE(b.get_element(v) == 7);
+        REQUIRE(b.sum() == Approx(n * lattice.size(e_x)));
+    }
+    SECTION("Neighbour read after write") {
+        onsites(ALL) a[X] = X.coordinate(e_x);
+        onsites(ALL) b[X] = a[X + e_x] - a[X];
+        REQUIRE(b.get_element(v) == 1);
+        v[e_x] = lattice.size(e_x) - 1;
+        REQUIRE(b.get_element(v) == 1 - lattice.size(e_x));
+    }
+    SECTION("Reduction used in the next loop") {
+        double s = 0;
+        onsites(ALL) a[X] = X.coordinate(e_x);
+        onsites(ALL) s += a[X];
+        onsites(ALL) c[X] = a[X] - s / n;
+        REQUIRE(c.sum() == Approx(0).margin(1e-6 * n));
+    }
+    SECTION("Different parities") {
+        onsites(EVEN) a[X] = 1;
+        onsites(ODD) a[X] = 2;
+        REQUIRE(a.sum() == Approx(1.5 * n));
+    }
+}
+
+TEST_CASE_METHOD(FieldTest, "Counter-based site random numbers", "[Field]") {
+    hila::site_rng rng(1234);
+    Field<double> a, b;
+    onsites(ALL) a[X] = rng.random(X.coordinates(), 3);
+    onsites(EVEN) b[X] = rng.random(X.coordinates(), 3);
+    onsites(ODD) b[X] = rng.random(X.coordinates(), 3);
+    SECTION("Independent of the loop") {
+        REQUIRE(a == b);
+        REQUIRE(a.min() >= 0);
+        REQUIRE(a.max() < 1);
+    }
+    SECTION("New numbers on the next sweep") {
+        rng.next_sweep();
+        onsites(ALL) b[X] = rng.random(X.coordinates(), 3);
+        REQUIRE(a.get_element({1, 1, 1}) != b.get_element({1, 1, 1}));
+    }
+}
+
+TEST_CASE_METHOD(FieldTest, "Random numbers in site loops", "[Field]") {
+    // on AVX with hilapp option -vectorize-random these loops use the vectorized generator
+    Field<double> a;
+    Field<Complex<double>> g;
+    onsites(ALL) a[X] = hila::random();
+    onsites(ALL) g[X].gaussian_random();
+    double n = lattice.volume();
+    SECTION("Uniform and gaussian distributions") {
+        REQUIRE(a.min() >= 0);
+        REQUIRE(a.max() < 1);
+        REQUIRE(a.sum() / n == Approx(0.5).margin(0.01));
+        double g2 = 0;
+        onsites(ALL) g2 += g[X].squarenorm();
+        REQUIRE(g2 / n == Approx(2.0).margin(0.05));
+    }
+    SECTION("Different numbers on all sites") {
+        CoordinateVector c;
+        c.fill(-1);
+        c[e_x] = 0;
+        auto v = a.get_slice(c, true);
+        std::sort(v.begin(), v.end());
+        REQUIRE(std::adjacent_find(v.begin(), v.end()) == v.end());
+    }
+}
+
+TEST_CASE_METHOD(FieldTest, "Field write and read", "[Field]") {
+    Field<MyType> temporary_field;
+    fill_dummy_field();
+    SECTION("Binary write and read back") {
+        dummy_field.write("field_io_test.dat");
+        temporary_field.read("field_io_test.dat");
+        REQUIRE(temporary_field == dummy_field);
+    }
+    SECTION("Checksum of write and read agree") {
+        hila::site_checksum write_sum, read_sum;
+        std::ofstream out;
+        hila::open_output_file("field_io_test.dat", out);
+        dummy_field.write(out, true, 8, &write_sum);
+        hila::close_file("field_io_test.dat", out);
+        std::ifstream in;
+        hila::open_input_file("field_io_test.dat", in);
+        temporary_field.read(in, &read_sum);
+        hila::close_file("field_io_test.dat", in);
+        write_sum.reduce();
+        read_sum.reduce();
+        REQUIRE(write_sum == read_sum);
+        REQUIRE((write_sum.a != 0 || write_sum.b != 0));
+    }
+}
+
+TEST_CASE_METHOD(FieldTest, "GaugeField configuration files", "[Field]") {
+    // file format: fingerprints of the original and extended headers, and int64 words
+    // in the extended header with and without checksum
+    const int64_t config_flag = 394824242, config_flag_encoded = 394824243;
+    const int64_t header_words = 7 + NDIM, header_words_no_checksum = 5 + NDIM;
+    const std::string name = "config_io_test.dat";
+    GaugeField<Complex<double>> U, V;
+    foralldir(d) onsites(ALL) U[d][X].gaussian_random();
+    int64_t flag = 0, size = 0;
+    auto read_flag_and_size = [&]() {
+        if (hila::myrank() == 0) {
+            std::ifstream in(name, std::ios::binary);
+            in.read(reinterpret_cast<char *>(&flag), sizeof(int64_t));
+            in.seekg(0, std::ios::end);
+            size = in.tellg();
+        }
+        hila::broadcast(flag);
+        hila::broadcast(size);
+    };
+    int64_t data_size = NDIM * lattice.volume() * sizeof(Complex<double>);
+    SECTION("Full precision file has the original layout") {
+        U.config_write(name);
+        read_flag_and_size();
+        REQUIRE(flag == config_flag);
+        REQUIRE(size == (3 + NDIM) * (int64_t)sizeof(int64_t) + data_size);
+        V.config_read(name);
+        foralldir(d) REQUIRE(V[d] == U[d]);
+    }
+    SECTION("Checksummed file") {
+        U.config_write(name, hila::config_encoding::full, true);
+        read_flag_and_size();
+        REQUIRE(flag == config_flag_encoded);
+        REQUIRE(size == header_words * (int64_t)sizeof(int64_t) + data_size);
+        V.config_read(name);
+        foralldir(d) REQUIRE(V[d] == U[d]);
+    }
+    SECTION("Single precision file without checksum") {
+        U.config_write(name, hila::config_encoding::single_precision);
+        read_flag_and_size();
+        REQUIRE(flag == config_flag_encoded);
+        REQUIRE(size == header_words_no_checksum * (int64_t)sizeof(int64_t) + data_size / 2);
+        V.config_read(name);
+        foralldir(d) onsites(ALL) V[d][X] -= U[d][X];
+        foralldir(d) REQUIRE(V[d].squarenorm() < 1e-12 * lattice.volume());
+    }
+}
+
+TEST_CASE_METHOD(FieldTest, "Memory mapped configuration", "[Field]") {
+    using T = Complex<double>;
+    const std::string name = "mapped_config_test.dat";
+    GaugeField<T> U, V;
+    foralldir(d) onsites(ALL) U[d][X].gaussian_random();
+    SECTION("Original and checksummed files") {
+        for (bool checksum : {false, true}) {
+            U.config_write(name, hila::config_encoding::full, checksum);
+            hila::mapped_config<T> cfg(name);
+            V = 0;
+            cfg.read(V);
+            foralldir(d) REQUIRE(V[d] == U[d]);
+        }
+    }
+    SECTION("Slices and subvolumes") {
+        U.config_write(name);
+        hila::mapped_config<T> cfg(name);
+        CoordinateVector c, cmin, cmax;
+        foralldir(d) {
+            c[d] = -1;
+            cmin[d] = 1;
+            cmax[d] = lattice.size(d) / 2;
+        }
+        c[e_y] = 3;
+        foralldir(d) {
+            REQUIRE(cfg.get_slice(d, c) == U[d].get_slice(c, true));
+            REQUIRE(cfg.get_subvolume(d, cmin, cmax) == U[d].get_subvolume(cmin, cmax, true));
+        }
+        // slice at fixed x: one site per x-run
+        foralldir(d) c[d] = -1;
+        c[e_x] = lattice.size(e_x) - 1;
+        REQUIRE(cfg.get_slice(e_z, c) == U[e_z].get_slice(c, true));
+    }
+}
+
+// SciDAC checksum of the binary data record, computed on rank 0 from the file site by site
+static hila::site_checksum file_checksum(const std::string &name, int64_t offset,
+                                         size_t site_bytes) {
+    hila::site_checksum sum;
+    if (hila::myrank() == 0) {
+        std::ifstream in(name, std::ios::binary);
+        in.seekg(offset);
+        std::vector<char> site(site_bytes);
+        for (int64_t r = 0; r < lattice.volume(); r++) {
+            in.read(site.data(), site_bytes);
+            sum.add(r, site.data(), site_bytes);
+        }
+    }
+    hila::broadcast(sum.a);
+    hila::broadcast(sum.b);
+    return sum;
+}
+
+TEST_CASE_METHOD(FieldTest, "ILDG files", "[Field]") {
+    const std::string name = "ildg_io_test.lime";
+    SECTION("LIME records and binary data") {
+        // ILDG site records are matrices of complex numbers, here one number per site
+        using T = Complex<double>;
+        Field<T> f;
+        onsites(ALL) f[X].gaussian_random();
+        const int64_t data_bytes = lattice.volume() * sizeof(T);
+
+        int64_t offset = 0;
+        if (hila::myrank() == 0) {
+            std::ofstream out(name, std::ios::out | std::ios::trunc | std::ios::binary);
+            hila::write_lime_record(out, "ildg-format", "<ildgFormat/>", true, false);
+            hila::write_lime_header(out, "ildg-binary-data", data_bytes, false, true);
+            offset = out.tellp();
+        }
+        hila::broadcast(offset);
+
+        std::vector<T> local, buffer;
+        f.copy_local_data(local);
+        buffer = local;
+        hila::site_checksum write_sum, read_sum;
+        MPI_File fh;
+        hila::open_mpi_file(name, fh, true);
+        hila::write_ildg_data(fh, offset, buffer.data(), sizeof(T), sizeof(double), write_sum);
+        hila::close_mpi_file(name, fh);
+        write_sum.reduce();
+
+        std::vector<hila::lime_record> records;
+        bool records_ok = true;
+        if (hila::myrank() == 0) {
+            std::ifstream in(name, std::ios::binary);
+            records_ok = hila::read_lime_records(in, records) && records.size() == 2 &&
+                         records[0].type == "ildg-format" &&
+                         records[1].type == "ildg-binary-data" &&
+                         records[1].offset == offset && records[1].bytes == data_bytes;
+        }
+        REQUIRE(hila::broadcast(records_ok));
+        REQUIRE(hila::is_lime_file(name));
+
+        std::fill(buffer.begin(), buffer.end(), T(0));
+        hila::open_mpi_file(name, fh, false);
+        hila::read_ildg_data(fh, offset, buffer.data(), sizeof(T), sizeof(double), read_sum);
+        hila::close_mpi_file(name, fh);
+        read_sum.reduce();
+
+        int mismatches = 0;
+        for (size_t i = 0; i < local.size(); i++)
+            if (buffer[i] != local[i])
+                mismatches++;
+        hila::reduce_node_sum(&mismatches, 1);
+        REQUIRE(mismatches == 0);
+        REQUIRE(read_sum == write_sum);
+        REQUIRE(file_checksum(name, offset, sizeof(T)) == write_sum);
+    }
+#if NDIM == 4
+    SECTION("Gauge configuration round trip") {
+        using T = SU<3, double>;
+        GaugeField<T> U, V;
+        foralldir(d) onsites(ALL) U[d][X].random();
+        for (int precision : {64, 32}) {
+            U.config_write_ildg(name, precision, "lfn://hila/test");
+            hila::ildg_info info;
+            REQUIRE(hila::read_ildg_info(name, info));
+            REQUIRE(info.ncolor == 3);
+            REQUIRE(info.precision == precision);
+            REQUIRE(info.has_checksum);
+            auto sum = file_checksum(name, info.data_offset, NDIM * 9 * 2 * precision / 8);
+            REQUIRE(sum.a == info.checksum_a);
+            REQUIRE(sum.b == info.checksum_b);
+
+            // config_read_ildg() terminates if the checksum does not match
+            V.config_read_ildg(name);
+            double tolerance = (precision == 64) ? 0 : 1e-5;
+            foralldir(d) {
+                onsites(ALL) V[d][X] -= U[d][X];
+                REQUIRE(V[d].squarenorm() <= tolerance * tolerance * lattice.volume());
+            }
+        }
+    }
+#endif
+}
+
+// generation of a sharded file set, from the manifest
+static int64_t shard_generation(const std::string &name) {
+    int64_t generation = 0;
+    if (hila::myrank() == 0) {
+        std::ifstream in(name);
+        std::string key;
+        while (in >> key && key != "shard")
+            if (key == "generation")
+                in >> generation;
+    }
+    return hila::broadcast(generation);
+}
+
+static bool file_exists(const std::string &name) {
+    return std::ifstream(name).good();
+}
+
+TEST_CASE_METHOD(FieldTest, "Sharded write and read", "[Field]") {
+    const std::string name = "field_shard_test";
+    Field<MyType> temporary_field;
+    fill_dummy_field();
+    SECTION("Write and read back") {
+        dummy_field.write_sharded(name);
+        temporary_field.read_sharded(name);
+        REQUIRE(temporary_field == dummy_field);
+    }
+    SECTION("New generation replaces the old one") {
+        dummy_field.write_sharded(name);
+        int64_t gen = shard_generation(name);
+        dummy_field.write_sharded(name);
+        REQUIRE(shard_generation(name) == gen + 1);
+        REQUIRE(file_exists(hila::shard_filename(name, gen + 1, hila::myrank())));
+        REQUIRE_FALSE(file_exists(hila::shard_filename(name, gen, hila::myrank())));
+    }
+    SECTION("Asynchronous write") {
+        Field<MyType> previous = dummy_field;
+        dummy_field.write_sharded(name);
+        fill_dummy_field();
+        Field<MyType> written = dummy_field;
+        dummy_field.write_async(name);
+        // the field can be changed right away, the file set is the previous one
+        // until wait_checkpoint()
+        dummy_field = 0;
+        temporary_field.read_sharded(name);
+        REQUIRE(temporary_field == previous);
+        REQUIRE(hila::wait_checkpoint());
+        temporary_field.read_sharded(name);
+        REQUIRE(temporary_field == written);
+        REQUIRE_FALSE(hila::wait_checkpoint());
+    }
+    SECTION("GaugeField asynchronous checkpoint") {
+        GaugeField<Complex<double>> U, V;
+        foralldir(d) onsites(ALL) U[d][X].gaussian_random();
+        U.config_write_async(name);
+        hila::wait_checkpoint();
+        V.config_read_sharded(name);
+        foralldir(d) REQUIRE(V[d] == U[d]);
+    }
+}
+
+// Value of the test field at coordinate c, exact in double
+static double site_value(const CoordinateVector &c) {
+    double v = 0, w = 1;
+    foralldir(d) {
+        v += w * c[d];
+        w *= 1000;
+    }
+    return v;
+}
+
+// Write on rank 0 a sharded file set of one double field as if written with a layout
+// of parts nodes in the x-direction
+static void write_layout_shards(const std::string &name, int parts) {
+    if (hila::myrank() == 0) {
+        std::ofstream manifest(name);
+        manifest << "hila-sharded-fields 2\ngeneration 1\nndim " << NDIM << "\nlattice";
+        foralldir(d) manifest << ' ' << lattice.size(d);
+        manifest << "\ndivisions";
+        foralldir(d) manifest << ' ' << (d == e_x ? parts : 1);
+        manifest << "\nranks " << parts << "\nfields 1\nelement_size " << sizeof(double)
+                 << '\n';
+
+        for (int p = 0; p < parts; p++) {
+            CoordinateVector min = 0, size = lattice.size();
+            min[e_x] = p * lattice.size(e_x) / parts;
+            size[e_x] = (p + 1) * lattice.size(e_x) / parts - min[e_x];
+            int64_t sites = 1;
+            foralldir(d) sites *= size[d];
+
+            std::vector<double> data(sites);
+            for (int64_t i = 0; i < sites; i++) {
+                CoordinateVector c;
+                int64_t r = i;
+                foralldir(d) {
+                    c[d] = min[d] + r % size[d];
+                    r /= size[d];
+                }
+                data[i] = site_value(c);
+            }
+            std::ofstream out(hila::shard_filename(name, 1, p), std::ios::binary);
+            out.write(reinterpret_cast<char *>(data.data()), sites * sizeof(double));
+
+            manifest << "shard " << p << " min";
+            foralldir(d) manifest << ' ' << min[d];
+            manifest << " size";
+            foralldir(d) manifest << ' ' << size[d];
+            manifest << " crc32 " << hila::crc32(0, data.data(), sites * sizeof(double))
+                     << '\n';
+        }
+    }
+    hila::synchronize();
+}
+
+TEST_CASE_METHOD(FieldTest, "Sharded read with different layout", "[Field]") {
+    const std::string name = "layout_shard_test";
+    Field<double> f, expected;
+    onsites(ALL) {
+        double v = 0, w = 1;
+        foralldir(d) {
+            v += w * X.coordinate(d);
+            w *= 1000;
+        }
+        expected[X] = v;
+    }
+    SECTION("One shard") {
+        write_layout_shards(name, 1);
+        f.read_sharded(name);
+        REQUIRE(f == expected);
+    }
+    SECTION("Shards split in x-direction") {
+        write_layout_shards(name, 3);
+        f.read_sharded(name);
+        REQUIRE(f == expected);
+    }
+    SECTION("Same layout round trip") {
+        expected.write_sharded(name);
+        f.read_sharded(name);
+        REQUIRE(f == expected);
+    }
+}
+
+TEST_CASE_METHOD(FieldTest, "Dropped gathers", "[Field]") {
+    // a gather dropped before it is waited for must not leave messages behind for
+    // later gathers (persistent gathers reuse their tags).  With SHARED_MEMORY_HALO
+    // the drop is a blocking wait_gather() for neighbours on the same host
+    Field<MyType> b;
+    CoordinateVector v = 0;
+    fill_dummy_field();
+    SECTION("Field changed during a gather") {
+        dummy_field.start_gather(e_x, ALL);
+        onsites(ALL) dummy_field[X] = X.coordinate(e_x);
+        onsites(ALL) b[X] = dummy_field[X + e_x] - dummy_field[X];
+        REQUIRE(b.get_element(v) == 1);
+        v[e_x] = lattice.size(e_x) - 1;
+        REQUIRE(b.get_element(v) == 1 - lattice.size(e_x));
+    }
+    SECTION("Field freed during a gather") {
+        {
+            Field<MyType> tmp = dummy_field;
+            tmp.start_gather(e_y, ALL);
+        }
+        Field<MyType> a;
+        onsites(ALL) a[X] = X.coordinate(e_y);
+        onsites(ALL) b[X] = a[X + e_y] - a[X];
+        REQUIRE(b.get_element(v) == 1);
+    }
+}
+
+TEST_CASE_METHOD(FieldTest, "Many gathers in flight", "[Field]") {
+    // gathers of several fields and directions going on at the same time, waited for
+    // in a different order.  Messages of different gathers (and the acknowledgements of
+    // the shared memory halo exchange) must not be mixed
+    Field<double> a, b, c;
+    onsites(ALL) {
+        a[X] = X.coordinate(e_x);
+        b[X] = X.coordinate(e_y);
+    }
+    foralldir(d) {
+        a.start_gather(d, ALL);
+        a.start_gather(-d, ALL);
+        b.start_gather(d, ALL);
+        b.start_gather(-d, ALL);
+    }
+    onsites(ALL) c[X] = b[X + e_y] - b[X - e_y];
+    onsites(ALL) c[X] += a[X + e_x] - a[X - e_x];
+    CoordinateVector v;
+    foralldir(d) v[d] = 1;
+    REQUIRE(c.get_element(v) == 4);
+    v[e_x] = 0;
+    REQUIRE(c.get_element(v) == 4 - lattice.size(e_x));
+}
+
+TEST_CASE_METHOD(FieldTest, "Batched gathers", "[Field]") {
+    // fields of different element sizes, so that the parts of the messages differ
+    Field<double> a, a_batch, r, r_batch;
+    Field<Complex<float>> b, b_batch;
+    onsites(ALL) {
+        a[X] = hila::gaussrand();
+        b[X].gaussian_random();
+    }
+    a_batch = a;
+    b_batch = b;
+    SECTION("Same halos as single gathers") {
+        for (Parity par : {EVEN, ODD, ALL}) {
+            a_batch = a;
+            b_batch = b;
+            hila::gather_batch gathers;
+            foralldir(d) gathers.add(a_batch, d, par).add(a_batch, -d, par).add(b_batch, d, par);
+            gathers.start();
+            gathers.wait();
+            r = 0;
+            r_batch = 0;
+            foralldir(d) {
+                onsites(par) r[X] += a[X + d] - a[X - d] + b[X + d].re * b[X + d].im;
+                onsites(par) r_batch[X] +=
+                    a_batch[X + d] - a_batch[X - d] + b_batch[X + d].re * b_batch[X + d].im;
+            }
+            REQUIRE(r_batch == r);
+        }
+    }
+    SECTION("Loop completes the batch") {
+        hila::gather_batch gathers;
+        gathers.add(a_batch, e_y, ALL).add(b_batch, -e_z, ALL);
+        gathers.start();
+        onsites(ALL) r[X] = a[X + e_y] + b[X - e_z].re;
+        onsites(ALL) r_batch[X] = a_batch[X + e_y] + b_batch[X - e_z].re;
+        REQUIRE_FALSE(gathers.is_active());
+        REQUIRE(r_batch == r);
+    }
+    SECTION("Field changed during the batch") {
+        hila::gather_batch gathers;
+        gathers.add(a_batch, e_x, ALL);
+        gathers.start();
+        onsites(ALL) a_batch[X] = 2 * a[X];
+        onsites(ALL) r[X] = 2 * a[X + e_x];
+        onsites(ALL) r_batch[X] = a_batch[X + e_x];
+        REQUIRE(r_batch == r);
+    }
+}
+
+TEST_CASE_METHOD(FieldTest, "Field shift", "[Field]") {
+    Field<MyType> shifted;
+    fill_dummy_field();
+    CoordinateVector v = 0, c = 0;
+    v[e_x] = lattice.size(e_x) / 2;
+    v[e_y] = -1;
+    c[e_y] = 1;
+    SECTION("Long shift is a periodic move") {
+        dummy_field.shift(v, shifted, ALL);
+        REQUIRE(shifted.get_element(c) == dummy_field.get_element((c + v).mod(lattice.size())));
+    }
+    SECTION("Shift of one parity") {
+        shifted = 0;
+        dummy_field.shift(v, shifted, ODD);
+        REQUIRE(shifted.get_element(c) == dummy_field.get_element((c + v).mod(lattice.size())));
+        c[e_y] = 0;
+        REQUIRE(shifted.get_element(c) == 0);
+    }
+    SECTION("Several offsets in one round") {
+        Field<MyType> s1, s2, s3;
+        CoordinateVector w = 0;
+        w[e_x] = 1;
+        w[e_y] = 1;
+        dummy_field.shift({v, w, 2 * e_z}, {&s1, &s2, &s3}, ALL);
+        REQUIRE(s1.get_element(c) == dummy_field.get_element((c + v).mod(lattice.size())));
+        REQUIRE(s2.get_element(c) == dummy_field.get_element((c + w).mod(lattice.size())));
+        REQUIRE(s3.get_element(c) == dummy_field.get_element((c + 2 * e_z).mod(lattice.size())));
+    }
+    SECTION("Offset references in a loop") {
+        Field<MyType> r;
+        onsites(ALL) r[X] = dummy_field[X + e_x + e_y] - dummy_field[X + 2 * e_x];
+        CoordinateVector origin = 0, w = 0, u = 0;
+        w[e_x] = 1;
+        w[e_y] = 1;
+        u[e_x] = 2;
+        REQUIRE(r.get_element(origin) ==
+                dummy_field.get_element(w) - dummy_field.get_element(u));
+    }
+    SECTION("More shift offsets than cached gathers") {
+        // gathers of the earliest offsets are dropped from the cache and created again
+        for (int i = 0; i < 2 * GEN_GATHER_CACHE_SIZE + 2; i++) {
+            v[e_x] = 2 + i % (GEN_GATHER_CACHE_SIZE + 1);
+            dummy_field.shift(v, shifted, ALL);
+            REQUIRE(shifted.get_element(c) ==
+                    dummy_field.get_element((c + v).mod(lattice.size())));
+        }
+    }
+}
@@ -254,6 +254,40 @@ TEST_CASE_METHOD(TestLattice, "Node information", "[MPI][.]") {
     }
 }
 
+TEST_CASE_METHOD(TestLattice, "Interior and boundary site lists", "[MPI][.]") {
+    auto off_node = [](unsigned i) {
+        bool off = false;
+        foralldir(d) off = off || lattice.neighb[d][i] >= lattice.mynode.sites ||
+                           lattice.neighb[-d][i] >= lattice.mynode.sites;
+        return off;
+    };
+    for (Parity par : {EVEN, ODD, ALL}) {
+        INFO("Parity " << hila::prettyprint(par));
+        auto interior = lattice.wait_site_list(par, false);
+        auto boundary = lattice.wait_site_list(par, true);
+        unsigned n = lattice.loop_end(par) - lattice.loop_begin(par);
+        REQUIRE(interior.size() + boundary.size() == n);
+
+        // each site of the parity is in one of the lists, the right one
+        std::vector<int> seen(lattice.mynode.sites, 0);
+        int wrong = 0;
+        for (int b = 0; b < 2; b++) {
+            auto list = lattice.wait_site_list(par, b == 1);
+            for (unsigned k = 0; k < list.size(); k++) {
+                unsigned i = list.data()[k];
+                seen[i]++;
+                if (off_node(i) != (b == 1) || (par != ALL && lattice.site_parity(i) != par))
+                    wrong++;
+            }
+        }
+        REQUIRE(wrong == 0);
+        for (unsigned i = lattice.loop_begin(par); i < lattice.loop_end(par); i++)
+            if (seen[i] != 1)
+                wrong++;
+        REQUIRE(wrong == 0);
+    }
+}
+
 TEST_CASE_METHOD(TestLattice, "Lattice split", "[MPI][.]") {
 
     if (num_nodes == 2) {
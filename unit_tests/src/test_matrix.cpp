@@ -288,4 +288,16 @@ TEST_CASE_METHOD(MatrixTest, "Matrix mathematical operations", "[Matrix]") {
 
     }
 
-}
\ No newline at end of file
+}
+TEST_CASE("SU(N) last row reconstruction", "[Matrix]") {
+    SU<3, double> u, v;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            u.e(i, j) = Complex<double>(sin(1.0 + 3 * i + j * j), cos(2.0 * i * j + j));
+    u.reunitarize();
+    v = u;
+    for (int j = 0; j < 3; j++)
+        v.e(2, j) = 0;
+    v.reconstruct_last_row();
+    REQUIRE((u - v).norm() < 1e-12);
+}
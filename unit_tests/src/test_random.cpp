@@ -0,0 +1,96 @@
+#include "hila.h"
+#include "catch.hpp"
+
+#if defined(AVX)
+
+// Kolmogorov-Smirnov distance of two samples
+static double ks_distance(std::vector<double> a, std::vector<double> b) {
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    size_t i = 0, j = 0;
+    double d = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i] <= b[j])
+            i++;
+        else
+            j++;
+        d = std::max(d, std::abs((double)i / a.size() - (double)j / b.size()));
+    }
+    return d;
+}
+
+static double mean(const std::vector<double> &v) {
+    double s = 0;
+    for (double x : v)
+        s += x;
+    return s / v.size();
+}
+
+TEST_CASE("Vectorized and scalar random numbers", "[Random]") {
+    // the vectorized generator (backend_vector/defs.h) must give the same
+    // distributions as the scalar hila::random() and hila::gaussrand()
+    constexpr int lanes = VECTOR_SIZE / sizeof(double);
+    constexpr int n = 1 << 16;
+    using vtype = decltype(hila::random_vector<lanes>());
+    using ftype = decltype(hila::random_vector<2 * lanes>());
+
+    std::vector<double> vec, sca;
+    // KS critical value at 0.1% level for samples of size n
+    double dcrit = 1.95 * sqrt(2.0 / n);
+
+    SECTION("Uniform double") {
+        double buf[lanes];
+        for (int i = 0; i < n / lanes; i++) {
+            hila::random_vector<lanes>().store(buf);
+            vec.insert(vec.end(), buf, buf + lanes);
+        }
+        for (int i = 0; i < n; i++)
+            sca.push_back(hila::random());
+        REQUIRE(*std::min_element(vec.begin(), vec.end()) >= 0);
+        REQUIRE(*std::max_element(vec.begin(), vec.end()) < 1);
+        REQUIRE(mean(vec) == Approx(mean(sca)).margin(5 * sqrt(1.0 / (6 * n))));
+        REQUIRE(ks_distance(vec, sca) < dcrit);
+    }
+    SECTION("Uniform float") {
+        float buf[2 * lanes];
+        for (int i = 0; i < n / (2 * lanes); i++) {
+            hila::random_vector<2 * lanes>().store(buf);
+            vec.insert(vec.end(), buf, buf + 2 * lanes);
+        }
+        for (int i = 0; i < n; i++)
+            sca.push_back(hila::random());
+        REQUIRE(*std::min_element(vec.begin(), vec.end()) >= 0);
+        REQUIRE(*std::max_element(vec.begin(), vec.end()) < 1);
+        REQUIRE(ks_distance(vec, sca) < dcrit);
+    }
+    SECTION("Gaussian") {
+        double buf[lanes];
+        float fbuf[2 * lanes];
+        vtype g;
+        ftype fg;
+        for (int i = 0; i < n / (3 * lanes); i++) {
+            hila::gaussian_random(g);
+            g.store(buf);
+            vec.insert(vec.end(), buf, buf + lanes);
+            hila::gaussian_random(fg);
+            fg.store(fbuf);
+            vec.insert(vec.end(), fbuf, fbuf + 2 * lanes);
+        }
+        for (int i = 0; i < n; i++)
+            sca.push_back(hila::gaussrand());
+        REQUIRE(mean(vec) == Approx(mean(sca)).margin(5 * sqrt(2.0 / n)));
+        REQUIRE(ks_distance(vec, sca) < dcrit);
+    }
+    SECTION("Lanes are independent") {
+        double buf[lanes];
+        double c = 0;
+        for (int i = 0; i < n; i++) {
+            hila::random_vector<lanes>().store(buf);
+            c += (buf[0] - 0.5) * (buf[lanes - 1] - 0.5);
+        }
+        // correlation coefficient, variance of the uniform dist. is 1/12
+        REQUIRE(std::abs(12 * c / n) < 5 / sqrt(n));
+    }
+}
+
+#endif